@@ -0,0 +1,136 @@
+// benchmark harness for treemap_bench
+// every bench_*.cpp registers one or more suites, bench_main.cpp runs and reports them
+// (as a table on stdout and, with --json FILE, as machine-readable JSON for trend tracking)
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+
+    // command line options shared by all suites
+    struct options
+    {
+        size_t max_size = 1000000; // largest element count a suite may use
+        unsigned seed = 42;        // seed for all random workloads, fixed for reproducible runs
+        std::string json_file;     // write all results to this file as JSON, if not empty
+    };
+
+    // one measured workload
+    struct result
+    {
+        std::string suite;     // e.g. "string_keys"
+        std::string workload;  // e.g. "find_hit"
+        std::string container; // e.g. "treemap"
+        size_t n = 0;          // number of elements in the container
+        size_t ops = 0;        // number of operations timed
+        double seconds = 0;    // wall time for all ops
+        size_t heap_bytes = 0; // live heap bytes attributed to the container, 0 if not measured
+        size_t peak_rss = 0;   // peak resident set size of the process during the run, 0 if not measured
+        std::string note;      // extra information printed after the numbers, may be empty
+
+        result() = default;
+        // the identifying fields, the measurements are filled in afterwards
+        result(std::string suite, std::string workload, std::string container, size_t n, size_t ops)
+            : suite(std::move(suite)), workload(std::move(workload)), container(std::move(container)), n(n), ops(ops)
+        {
+        }
+    };
+
+    using suite_fn = void (*)(const options &);
+
+    // all registered suites, in registration order
+    inline std::vector<std::pair<std::string, suite_fn>> &suites()
+    {
+        static std::vector<std::pair<std::string, suite_fn>> all;
+        return all;
+    }
+
+    // static instance in a bench_*.cpp adds a suite
+    struct register_suite
+    {
+        register_suite(const char *name, suite_fn fn) { suites().emplace_back(name, fn); }
+    };
+
+    // print one result (defined in bench_main.cpp)
+    void report(const result &);
+
+    // bytes currently allocated through operator new (defined in bench_main.cpp)
+    size_t heap_bytes();
+
+    // peak resident set size since the last reset_peak_rss() (whole process since start if the
+    // kernel does not support resetting), 0 if unknown (defined in bench_main.cpp)
+    size_t peak_rss();
+    void reset_peak_rss();
+
+    // keep the compiler from optimizing away a computed value
+    template <typename V>
+    inline void do_not_optimize(const V &value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    // wall time of f() in seconds
+    template <typename F>
+    double time_seconds(F &&f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        auto stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(stop - start).count();
+    }
+
+    // draws ranks 0..n-1 with probability proportional to 1 / (rank+1)^s
+    // rank 0 is the hottest; map ranks through a permutation so hot keys are spread over the key space
+    class zipf_distribution
+    {
+    public:
+        zipf_distribution(size_t n, double s) : cdf_(n)
+        {
+            double sum = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                sum += 1.0 / std::pow(double(i + 1), s);
+                cdf_[i] = sum;
+            }
+            for (auto &c : cdf_)
+            {
+                c /= sum;
+            }
+        }
+
+        template <typename Rng>
+        size_t operator()(Rng &rng)
+        {
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            size_t rank = std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+            return std::min(rank, cdf_.size() - 1);
+        }
+
+    private:
+        std::vector<double> cdf_;
+    };
+
+    // the subset of candidate sizes allowed by --max-size
+    inline std::vector<size_t> sizes(const options &opt, std::vector<size_t> candidates)
+    {
+        std::vector<size_t> result;
+        for (size_t n : candidates)
+        {
+            if (n <= opt.max_size)
+            {
+                result.push_back(n);
+            }
+        }
+        return result;
+    }
+
+} // namespace bench
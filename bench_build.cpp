@@ -0,0 +1,73 @@
+// benchmark suite "build": a treemap from an unsorted vector of pairs (10% duplicate keys)
+// repeated operator[] against from_unsorted with 1 thread and with all hardware threads
+// (from_unsorted sorts a copy of the input, the copy is included in its time)
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+
+namespace
+{
+
+    void build(const bench::options &opt)
+    {
+        unsigned all = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t n : bench::sizes(opt, {100000, 1000000, 10000000, 100000000}))
+        {
+            std::mt19937 rng(opt.seed);
+            std::vector<std::pair<int, int>> input(n);
+            std::uniform_int_distribution<int> any(0, int(std::min<size_t>(n - n / 10, 1u << 30)));
+            for (size_t i = 0; i < n; i++)
+            {
+                input[i] = {any(rng), int(i)};
+            }
+
+            double insert_seconds;
+            {
+                my::treemap<int, int> m;
+                bench::result r{"build", "from_unsorted", "treemap operator[]", n, n};
+                size_t heap_before = bench::heap_bytes();
+                r.seconds = insert_seconds = bench::time_seconds([&]
+                                                                 {
+                    for (auto &[key, value] : input)
+                    {
+                        m[key] = value;
+                    } });
+                r.heap_bytes = bench::heap_bytes() - heap_before;
+                bench::report(r);
+            }
+
+            std::vector<unsigned> thread_counts{1};
+            if (all > 1)
+            {
+                thread_counts.push_back(all);
+            }
+            for (unsigned threads : thread_counts)
+            {
+                my::build_policy policy;
+                policy.threads = threads;
+                std::string name = "from_unsorted/" + std::to_string(threads) + "t";
+                bench::result r{"build", "from_unsorted", name, n, n};
+                size_t heap_before = bench::heap_bytes();
+                my::treemap<int, int> m;
+                r.seconds = bench::time_seconds([&]
+                                                { m = my::treemap<int, int>::from_unsorted(input, policy); });
+                r.heap_bytes = bench::heap_bytes() - heap_before;
+                char note[64];
+                std::snprintf(note, sizeof note, "%.1fx operator[]", insert_seconds / r.seconds);
+                r.note = note;
+                bench::report(r);
+            }
+        }
+    }
+
+    bench::register_suite reg("build", build);
+
+} // namespace
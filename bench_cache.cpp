@@ -0,0 +1,106 @@
+// benchmark suite "cache": sustained writes of new keys into a map that must stay at about n entries
+// cache_treemap with lru, fifo and ttl against a treemap that is cleared whenever it gets too big
+// heap is what stays allocated at the end, the note gives the slowest single write
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "cache_treemap.h"
+
+namespace
+{
+
+    // one tick per write, so a ttl of n ticks keeps about n entries alive
+    struct write_clock
+    {
+        using duration = std::chrono::nanoseconds;
+        using rep = duration::rep;
+        using period = duration::period;
+        using time_point = std::chrono::time_point<write_clock>;
+        static const bool is_steady = true;
+        static inline rep ticks = 0;
+        static time_point now() { return time_point(duration(ticks)); }
+    };
+
+    using cache = my::cache_treemap<int, int, std::less<int>, write_clock>;
+
+    // time every write, keep the total and the worst one
+    template <typename Write>
+    void run(const char *workload, const char *name, size_t n, const std::vector<int> &keys, Write write)
+    {
+        bench::result r{"cache", workload, name, n, keys.size()};
+        size_t heap_before = bench::heap_bytes();
+        double worst = 0;
+        write_clock::ticks = 0;
+        for (int k : keys)
+        {
+            write_clock::ticks++;
+            double seconds = bench::time_seconds([&]
+                                                 { write(k); });
+            r.seconds += seconds;
+            worst = std::max(worst, seconds);
+        }
+        r.heap_bytes = bench::heap_bytes() - heap_before;
+        char note[64];
+        std::snprintf(note, sizeof note, "slowest write %.1f us", worst * 1e6);
+        r.note = note;
+        bench::report(r);
+    }
+
+    void cache_suite(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {1000, 100000, 1000000}))
+        {
+            // 10 writes per entry of the budget, almost all of them new keys
+            std::mt19937 rng(opt.seed);
+            std::vector<int> keys(10 * n);
+            std::uniform_int_distribution<int> any(0, int(std::min<size_t>(100 * n, 1u << 30)));
+            for (auto &k : keys)
+            {
+                k = any(rng);
+            }
+
+            {
+                my::cache_options options;
+                options.max_size = n;
+                cache c(options);
+                run("sustained_writes", "cache_treemap lru", n, keys, [&](int k)
+                    { c.insert_or_assign(k, k); });
+            }
+            {
+                my::cache_options options;
+                options.max_size = n;
+                options.eviction = my::cache_eviction::fifo;
+                cache c(options);
+                run("sustained_writes", "cache_treemap fifo", n, keys, [&](int k)
+                    { c.insert_or_assign(k, k); });
+            }
+            {
+                cache c;
+                write_clock::duration ttl(n);
+                run("sustained_writes", "cache_treemap ttl", n, keys, [&](int k)
+                    { c.insert_or_assign(k, k, ttl); });
+            }
+            {
+                // stop-the-world purge: drop everything once the map holds twice the budget
+                my::treemap<int, int> m;
+                run("sustained_writes", "treemap + clear()", n, keys, [&](int k)
+                    {
+                    if (m.size() >= 2 * n)
+                    {
+                        m.clear();
+                    }
+                    m[k] = k; });
+            }
+        }
+    }
+
+    bench::register_suite reg("cache", cache_suite);
+
+} // namespace
@@ -0,0 +1,204 @@
+// benchmark suite "core": the basic operations of treemap (plain, scapegoat, compact) against std::map
+// random / sorted / Zipf inserts, hits, misses, full iteration, range scans, copy and clear
+// sizes 1K .. 100M (limited by --max-size), all inputs generated from --seed
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "compact_treemap.h"
+
+namespace
+{
+
+    // treemap has no balancing: sorted input builds a list, which takes quadratic time and
+    // recursion as deep as the list when copying or destroying - so only small sorted runs
+    const size_t treemap_sorted_limit = 10000;
+
+    // treemap with scapegoat rebuilding switched on from the start
+    struct scapegoat_treemap : my::treemap<int, int>
+    {
+        scapegoat_treemap() { scapegoat(0.7); }
+    };
+
+    // elements visited per range scan
+    const size_t scan_length = 100;
+
+    // inputs shared by all containers of one size
+    struct workload_data
+    {
+        std::vector<int> random_keys; // even numbers 0 .. 2n-2 in random order
+        std::vector<int> sorted_keys; // the same keys ascending
+        std::vector<int> zipf_keys;   // n draws from the keys, Zipf(0.99) distributed (many duplicates)
+        std::vector<int> hits;        // lookups of present keys
+        std::vector<int> misses;      // lookups of absent (odd) keys
+        std::vector<int> scan_starts; // lower bounds of the range scans
+
+        workload_data(size_t n, unsigned seed)
+        {
+            std::mt19937 rng(seed);
+            sorted_keys.resize(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                sorted_keys[i] = int(2 * i);
+            }
+            random_keys = sorted_keys;
+            std::shuffle(random_keys.begin(), random_keys.end(), rng);
+
+            bench::zipf_distribution hot(n, 0.99);
+            zipf_keys.resize(n);
+            for (auto &k : zipf_keys)
+            {
+                k = random_keys[hot(rng)];
+            }
+
+            size_t lookups = std::min<size_t>(std::max<size_t>(n, 100000), 10000000);
+            std::uniform_int_distribution<size_t> any(0, n - 1);
+            hits.resize(lookups);
+            misses.resize(lookups);
+            for (size_t i = 0; i < lookups; i++)
+            {
+                hits[i] = sorted_keys[any(rng)];
+                misses[i] = sorted_keys[any(rng)] + 1;
+            }
+            scan_starts.resize(lookups / scan_length);
+            for (auto &k : scan_starts)
+            {
+                k = int(any(rng) * 2);
+            }
+        }
+    };
+
+    // time f() as one result of the core suite and report it
+    template <typename F>
+    void measure(const char *workload, const char *container, size_t n, size_t ops, F f)
+    {
+        bench::result r{"core", workload, container, n, ops};
+        r.seconds = bench::time_seconds(f);
+        r.peak_rss = bench::peak_rss();
+        bench::report(r);
+    }
+
+    template <typename Map, typename Insert>
+    void run(const char *name, size_t n, const workload_data &d, size_t sorted_limit, Insert insert)
+    {
+        bench::reset_peak_rss();
+        size_t heap_before = bench::heap_bytes();
+        size_t sink = 0;
+
+        {
+            Map m;
+            bench::result build{"core", "insert_random", name, n, n};
+            build.seconds = bench::time_seconds([&]
+                                                {
+                for (int k : d.random_keys)
+                {
+                    insert(m, k);
+                } });
+            build.heap_bytes = bench::heap_bytes() - heap_before;
+            build.peak_rss = bench::peak_rss();
+            bench::report(build);
+
+            measure("find_hit", name, n, d.hits.size(), [&]
+                    {
+                for (int k : d.hits)
+                {
+                    sink += m.count(k);
+                } });
+
+            measure("find_miss", name, n, d.misses.size(), [&]
+                    {
+                for (int k : d.misses)
+                {
+                    sink += m.count(k);
+                } });
+
+            measure("iterate", name, n, n, [&]
+                    {
+                for (auto it = m.begin(); it != m.end(); ++it)
+                {
+                    sink += (*it).second;
+                } });
+
+            measure("range_scan", name, n, d.scan_starts.size(), [&]
+                    {
+                for (int k : d.scan_starts)
+                {
+                    auto it = m.lower_bound(k);
+                    for (size_t i = 0; i < scan_length && it != m.end(); i++, ++it)
+                    {
+                        sink += (*it).second;
+                    }
+                } });
+
+            {
+                size_t heap_copy = bench::heap_bytes();
+                Map *copy = nullptr;
+                bench::result r{"core", "copy", name, n, n};
+                r.seconds = bench::time_seconds([&]
+                                                { copy = new Map(m); });
+                r.heap_bytes = bench::heap_bytes() - heap_copy;
+                r.peak_rss = bench::peak_rss();
+                bench::report(r);
+                delete copy;
+            }
+
+            measure("clear", name, n, n, [&]
+                    { m.clear(); });
+        }
+
+        {
+            Map m;
+            measure("insert_zipf", name, n, n, [&]
+                    {
+                for (int k : d.zipf_keys)
+                {
+                    insert(m, k);
+                } });
+            sink += m.size();
+        }
+
+        if (n <= sorted_limit)
+        {
+            Map m;
+            measure("insert_sorted", name, n, n, [&]
+                    {
+                for (int k : d.sorted_keys)
+                {
+                    insert(m, k);
+                } });
+            sink += m.size();
+        }
+        else
+        {
+            std::printf("# core insert_sorted %s %zu skipped: unbalanced tree would degenerate to a list\n", name, n);
+        }
+
+        bench::do_not_optimize(sink);
+    }
+
+    void core(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {1000, 10000, 100000, 1000000, 10000000, 100000000}))
+        {
+            workload_data d(n, opt.seed);
+
+            run<my::treemap<int, int>>("treemap", n, d, treemap_sorted_limit, [](auto &m, int k)
+                                       { m.insert(k, k); });
+            run<scapegoat_treemap>("treemap_scapegoat", n, d, n, [](auto &m, int k)
+                                   { m.insert(k, k); });
+            run<my::compact_treemap<int, int>>("compact_treemap", n, d, treemap_sorted_limit, [](auto &m, int k)
+                                               { m.insert(k, k); });
+            run<std::map<int, int>>("std::map", n, d, n, [](auto &m, int k)
+                                    { m.emplace(k, k); });
+        }
+    }
+
+    bench::register_suite reg("core", core);
+
+} // namespace
@@ -0,0 +1,65 @@
+// benchmark suite "coro": random lookups in maps far larger than the cache, one after the other
+// (find) against find_batch, which interleaves width coroutine lookups on one thread
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+
+namespace
+{
+
+    void coro(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {100000, 1000000, 10000000}))
+        {
+            // inserted in random order, so the tree is not a list and nodes are spread over the heap
+            std::mt19937 rng(opt.seed);
+            std::vector<int> keys(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                keys[i] = int(2 * i);
+            }
+            std::shuffle(keys.begin(), keys.end(), rng);
+            my::treemap<int, int> m;
+            for (int k : keys)
+            {
+                m[k] = k;
+            }
+
+            size_t lookups = 1000000;
+            std::vector<int> probes(lookups);
+            std::uniform_int_distribution<int> any(0, int(2 * n));
+            for (auto &k : probes)
+            {
+                k = any(rng);
+            }
+            std::vector<my::treemap<int, int>::iterator> found(lookups);
+
+            bench::result plain{"coro", "find", "treemap", n, lookups};
+            plain.seconds = bench::time_seconds([&]
+                                                {
+                for (size_t i = 0; i < lookups; i++)
+                {
+                    found[i] = m.find(probes[i]);
+                } });
+            bench::report(plain);
+
+            for (size_t width : {4, 16, 32})
+            {
+                std::string name = "treemap find_batch/" + std::to_string(width);
+                bench::result batch{"coro", "find", name, n, lookups};
+                batch.seconds = bench::time_seconds([&]
+                                                    { m.find_batch(probes.begin(), probes.end(), found.begin(), width); });
+                bench::report(batch);
+            }
+            bench::do_not_optimize(found);
+        }
+    }
+
+    bench::register_suite reg("coro", coro);
+
+} // namespace
@@ -0,0 +1,69 @@
+// benchmark suite "diff": bringing a replica up to date after a batch of writes to the primary
+// copying the whole map against diff() from the last shipped snapshot plus treemap::apply()
+// (1000 random writes per round: 2/3 assignments, 1/3 erases)
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+
+namespace
+{
+
+    void diff(const bench::options &opt)
+    {
+        const size_t writes = 1000;
+        for (size_t n : bench::sizes(opt, {100000, 1000000, 10000000}))
+        {
+            std::mt19937 rng(opt.seed);
+            my::treemap<int, int> primary;
+            for (size_t i = 0; i < n; i++)
+            {
+                primary[int(rng() % (2 * n))] = int(i);
+            }
+            my::treemap<int, int> replica(primary);
+            auto shipped = primary.snapshot();
+            for (size_t i = 0; i < writes; i++)
+            {
+                int key = int(rng() % (2 * n));
+                if (i % 3 == 0)
+                {
+                    primary.erase(key);
+                }
+                else
+                {
+                    primary[key] = int(i);
+                }
+            }
+
+            double copy_seconds;
+            {
+                bench::result r{"diff", "sync", "copy whole map", n, writes};
+                my::treemap<int, int> copy;
+                r.seconds = copy_seconds = bench::time_seconds([&]
+                                                               { copy = primary; });
+                bench::do_not_optimize(copy.size());
+                bench::report(r);
+            }
+            {
+                bench::result r{"diff", "sync", "diff + apply", n, writes};
+                my::treemap_delta<int, int> delta;
+                r.seconds = bench::time_seconds([&]
+                                                {
+                    delta = my::diff(shipped, primary);
+                    replica.apply(delta); });
+                bench::do_not_optimize(replica.size());
+                char note[96];
+                std::snprintf(note, sizeof note, "%zu changes, %zu nodes visited, %.0fx faster than a copy",
+                              delta.size(), delta.nodes_visited, copy_seconds / r.seconds);
+                r.note = note;
+                bench::report(r);
+            }
+        }
+    }
+
+    bench::register_suite reg("diff", diff);
+
+} // namespace
@@ -0,0 +1,103 @@
+// benchmark suite "durable": sustained write throughput of durable_treemap under each sync policy,
+// plus checkpoint, writes while a checkpoint runs, and recovery
+// files go to a fresh directory below /tmp (or $TMPDIR), removed afterwards
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "durable_treemap.h"
+
+namespace
+{
+
+    std::string fresh_directory()
+    {
+        const char *tmp = std::getenv("TMPDIR");
+        std::string pattern = std::string(tmp != nullptr ? tmp : "/tmp") + "/treemap_bench_XXXXXX";
+        return mkdtemp(pattern.data());
+    }
+
+    void insert_run(const char *policy_name, my::durable_options options, const std::vector<int> &keys)
+    {
+        std::string dir = fresh_directory();
+        {
+            my::durable_treemap<int, int> d(dir, options);
+            bench::result r{"durable", std::string("insert_") + policy_name, "durable_treemap", keys.size(), keys.size()};
+            r.seconds = bench::time_seconds([&]
+                                            {
+                for (int k : keys)
+                {
+                    d.insert(k, k);
+                }
+                d.sync(); });
+            r.note = "log " + std::to_string(d.log_bytes() >> 10) + " KB";
+            bench::report(r);
+        }
+        std::filesystem::remove_all(dir);
+    }
+
+    void durable(const bench::options &opt)
+    {
+        size_t n = std::min<size_t>(opt.max_size, 200000);
+        std::vector<int> keys(n);
+        for (size_t i = 0; i < n; i++)
+        {
+            keys[i] = int(i);
+        }
+        std::shuffle(keys.begin(), keys.end(), std::mt19937(opt.seed));
+
+        // one fdatasync per write is orders of magnitude slower, keep that run short
+        std::vector<int> few(keys.begin(), keys.begin() + std::min<size_t>(n, 2000));
+        insert_run("every_write", {my::sync_policy::every_write, 1, 0}, few);
+        insert_run("group_16", {my::sync_policy::group, 16, 0}, keys);
+        insert_run("group_128", {my::sync_policy::group, 128, 0}, keys);
+        insert_run("group_1024", {my::sync_policy::group, 1024, 0}, keys);
+        insert_run("none", {my::sync_policy::none, 1024, 0}, keys);
+
+        std::string dir = fresh_directory();
+        {
+            my::durable_treemap<int, int> d(dir, {my::sync_policy::group, 1024, 0});
+            for (int k : keys)
+            {
+                d.insert(k, k);
+            }
+
+            // the checkpoint is written from a snapshot in the background, writers go on
+            bench::result during{"durable", "insert_during_checkpoint", "durable_treemap", n, n};
+            bench::result total{"durable", "checkpoint", "durable_treemap", n, n};
+            total.seconds = bench::time_seconds([&]
+                                                {
+                d.checkpoint();
+                during.seconds = bench::time_seconds([&]
+                                                     {
+                    for (int k : keys)
+                    {
+                        d.insert_or_assign(k, k + 1);
+                    } });
+                d.wait_checkpoint(); });
+            total.note = "including the writes";
+            bench::report(during);
+            bench::report(total);
+        }
+        {
+            bench::result r{"durable", "recover", "durable_treemap", n, n};
+            size_t size = 0;
+            r.seconds = bench::time_seconds([&]
+                                            {
+                my::durable_treemap<int, int> d(dir);
+                size = d.size(); });
+            r.note = "checkpoint + log of " + std::to_string(n) + " records";
+            bench::do_not_optimize(size);
+            bench::report(r);
+        }
+        std::filesystem::remove_all(dir);
+    }
+
+    bench::register_suite reg("durable", durable);
+
+} // namespace
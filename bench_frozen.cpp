@@ -0,0 +1,80 @@
+// benchmark suite "frozen": random lookups of timestamp keys (about 1 per ms with jitter)
+// treemap against a sorted vector of pairs and frozen_treemap (bit-packed key deltas)
+// heap_bytes is the memory of the structure, the note gives bytes per element
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "frozen_treemap.h"
+
+namespace
+{
+
+    template <typename Find>
+    void lookups(const char *name, size_t n, size_t bytes, const std::vector<int64_t> &probes, Find find)
+    {
+        bench::result r{"frozen", "find", name, n, probes.size()};
+        long sum = 0;
+        r.seconds = bench::time_seconds([&]
+                                        {
+            for (int64_t key : probes)
+            {
+                sum += find(key);
+            } });
+        bench::do_not_optimize(sum);
+        r.heap_bytes = bytes;
+        char note[64];
+        std::snprintf(note, sizeof note, "%.1f bytes/element", double(bytes) / double(n));
+        r.note = note;
+        bench::report(r);
+    }
+
+    void frozen(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {100000, 1000000, 10000000}))
+        {
+            std::mt19937_64 rng(opt.seed);
+            std::vector<std::pair<int64_t, int64_t>> sorted(n);
+            int64_t t = 1700000000000; // ms since 1970
+            for (size_t i = 0; i < n; i++)
+            {
+                t += 500 + int64_t(rng() % 1000);
+                sorted[i] = {t, int64_t(i)};
+            }
+            // half hits, half misses between the keys
+            std::vector<int64_t> probes(1000000);
+            for (auto &key : probes)
+            {
+                key = sorted[rng() % n].first + int64_t(rng() % 2);
+            }
+
+            {
+                size_t heap_before = bench::heap_bytes();
+                my::treemap<int64_t, int64_t> m;
+                m.insert_sorted(sorted.begin(), sorted.end());
+                size_t bytes = bench::heap_bytes() - heap_before;
+                lookups("treemap", n, bytes, probes, [&](int64_t key)
+                        { auto it = m.find(key); return it != m.end() ? it->second : 0; });
+            }
+            lookups("sorted vector", n, sorted.capacity() * sizeof(sorted[0]), probes, [&](int64_t key)
+                    {
+                auto it = std::lower_bound(sorted.begin(), sorted.end(), key, [](const auto &e, int64_t k)
+                                           { return e.first < k; });
+                return it != sorted.end() && it->first == key ? it->second : 0; });
+            {
+                my::frozen_treemap<int64_t, int64_t> frozen(sorted.begin(), sorted.end());
+                lookups("frozen_treemap", n, frozen.bytes(), probes, [&](int64_t key)
+                        { const int64_t *value = frozen.find(key); return value != nullptr ? *value : 0; });
+            }
+        }
+    }
+
+    bench::register_suite reg("frozen", frozen);
+
+} // namespace
@@ -0,0 +1,120 @@
+// benchmark suite "hash_index": treemap with and without hash index against std::map and std::unordered_map
+// exact-key hits, misses and operator[] updates, what the index costs on insert and in memory,
+// and that ordered scans are unaffected
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+
+namespace
+{
+
+    // elements visited per range scan
+    const size_t scan_length = 100;
+
+    struct indexed_treemap : my::treemap<int, int>
+    {
+        indexed_treemap() { hash_index(true); }
+    };
+
+    template <typename Map>
+    void run(const char *name, size_t n, const std::vector<int> &keys, const std::vector<int> &hits,
+             const std::vector<int> &misses)
+    {
+        Map m;
+        bench::result build{"hash_index", "insert", name, n, n};
+        size_t heap_before = bench::heap_bytes();
+        build.seconds = bench::time_seconds([&]
+                                            {
+            for (int k : keys)
+            {
+                m[k] = k;
+            } });
+        build.heap_bytes = bench::heap_bytes() - heap_before;
+        bench::report(build);
+
+        size_t found = 0;
+        bench::result hit{"hash_index", "find_hit", name, n, hits.size()};
+        hit.seconds = bench::time_seconds([&]
+                                          {
+            for (int k : hits)
+            {
+                found += m.count(k);
+            } });
+        bench::report(hit);
+
+        bench::result miss{"hash_index", "find_miss", name, n, misses.size()};
+        miss.seconds = bench::time_seconds([&]
+                                           {
+            for (int k : misses)
+            {
+                found += m.count(k);
+            } });
+        bench::report(miss);
+
+        bench::result update{"hash_index", "operator[]_existing", name, n, hits.size()};
+        update.seconds = bench::time_seconds([&]
+                                             {
+            for (int k : hits)
+            {
+                m[k]++;
+            } });
+        bench::report(update);
+
+        // ordered containers only
+        if constexpr (requires { m.lower_bound(0); })
+        {
+            size_t scans = std::min<size_t>(hits.size(), 100000);
+            bench::result scan{"hash_index", "range_scan", name, n, scans * scan_length};
+            scan.seconds = bench::time_seconds([&]
+                                               {
+                for (size_t i = 0; i < scans; i++)
+                {
+                    auto it = m.lower_bound(hits[i]);
+                    for (size_t j = 0; j < scan_length && it != m.end(); j++, ++it)
+                    {
+                        found += size_t(it->second);
+                    }
+                } });
+            bench::report(scan);
+        }
+        bench::do_not_optimize(found);
+    }
+
+    void hash_index(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {1000, 100000, 1000000, 10000000}))
+        {
+            std::mt19937 rng(opt.seed);
+            std::vector<int> keys(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                keys[i] = int(2 * i);
+            }
+            std::shuffle(keys.begin(), keys.end(), rng);
+
+            size_t lookups = std::min<size_t>(std::max<size_t>(n, 100000), 10000000);
+            std::vector<int> hits(lookups), misses(lookups);
+            std::uniform_int_distribution<size_t> any(0, n - 1);
+            for (size_t i = 0; i < lookups; i++)
+            {
+                hits[i] = keys[any(rng)];
+                misses[i] = hits[i] + 1;
+            }
+
+            run<my::treemap<int, int>>("treemap", n, keys, hits, misses);
+            run<indexed_treemap>("treemap+hash_index", n, keys, hits, misses);
+            run<std::map<int, int>>("std::map", n, keys, hits, misses);
+            run<std::unordered_map<int, int>>("std::unordered_map", n, keys, hits, misses);
+        }
+    }
+
+    bench::register_suite reg("hash_index", hash_index);
+
+} // namespace
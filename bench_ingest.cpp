@@ -0,0 +1,101 @@
+// benchmark suite "ingest": a burst of random inserts into a map that already holds n keys
+// treemap against buffered_treemap (two buffer sizes) and std::map, then lookups right after the burst
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "buffered_treemap.h"
+
+namespace
+{
+
+    template <typename Map, typename Insert, typename Find>
+    void run(const char *name, size_t n, const std::vector<int> &initial, const std::vector<int> &burst,
+             const std::vector<int> &probes, Map &m, Insert insert, Find find)
+    {
+        for (int k : initial)
+        {
+            insert(m, k);
+        }
+
+        bench::result r{"ingest", "insert_burst", name, n, burst.size()};
+        r.seconds = bench::time_seconds([&]
+                                        {
+            for (int k : burst)
+            {
+                insert(m, k);
+            } });
+        bench::report(r);
+
+        // a buffered map still holds part of the burst in its buffer here
+        size_t found = 0;
+        bench::result lookup{"ingest", "find_after_burst", name, n, probes.size()};
+        lookup.seconds = bench::time_seconds([&]
+                                             {
+            for (int k : probes)
+            {
+                found += find(m, k);
+            } });
+        bench::do_not_optimize(found);
+        bench::report(lookup);
+    }
+
+    void ingest(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {100000, 1000000, 10000000}))
+        {
+            std::mt19937 rng(opt.seed);
+
+            // even keys already in the map, a burst of n/2 odd keys
+            std::vector<int> initial(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                initial[i] = int(2 * i);
+            }
+            std::shuffle(initial.begin(), initial.end(), rng);
+            std::vector<int> burst(n / 2);
+            std::uniform_int_distribution<int> any(0, int(n - 1));
+            for (auto &k : burst)
+            {
+                k = 2 * any(rng) + 1;
+            }
+            std::vector<int> probes(std::min<size_t>(n, 1000000));
+            for (auto &k : probes)
+            {
+                k = any(rng);
+            }
+
+            auto insert = [](auto &m, int k)
+            { m.insert(k, k); };
+            auto count = [](auto &m, int k)
+            { return m.count(k); };
+
+            {
+                my::treemap<int, int> m;
+                run("treemap", n, initial, burst, probes, m, insert, count);
+            }
+            {
+                my::buffered_treemap<int, int> m(1024);
+                run("buffered_1K", n, initial, burst, probes, m, insert, count);
+            }
+            {
+                my::buffered_treemap<int, int> m(16384);
+                run("buffered_16K", n, initial, burst, probes, m, insert, count);
+            }
+            {
+                std::map<int, int> m;
+                run("std::map", n, initial, burst, probes, m, [](auto &m, int k)
+                    { m.emplace(k, k); },
+                    count);
+            }
+        }
+    }
+
+    bench::register_suite reg("ingest", ingest);
+
+} // namespace
@@ -0,0 +1,113 @@
+// benchmark suite "interval": time windows, "which windows contain t" and "which overlap [a, b)"
+// interval_treemap against a treemap keyed by (start, end) that has to scan every window starting
+// before the query ends; build cost for single inserts in time order and for insert_sorted
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "interval_treemap.h"
+
+namespace
+{
+
+    using window = my::interval<int>;
+
+    void interval_suite(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {1000, 100000, 1000000}))
+        {
+            // windows start one after the other (average gap 10) and last 1..1000
+            std::mt19937 rng(opt.seed);
+            std::vector<std::pair<window, int>> windows(n);
+            int t = 0;
+            for (size_t i = 0; i < n; i++)
+            {
+                t += 1 + int(rng() % 19);
+                windows[i] = {window{t, t + 1 + int(rng() % 1000)}, int(i)};
+            }
+            std::uniform_int_distribution<int> any(0, t);
+            std::vector<int> points(std::min<size_t>(n, 100000));
+            for (auto &p : points)
+            {
+                p = any(rng);
+            }
+            // the scan is O(n) per query, fewer of them
+            size_t scans = std::min<size_t>(points.size(), 100000000 / n + 10);
+
+            long found = 0;
+            {
+                my::interval_treemap<int, int> m;
+                bench::result build{"interval", "insert_in_time_order", "interval_treemap", n, n};
+                size_t heap_before = bench::heap_bytes();
+                build.seconds = bench::time_seconds([&]
+                                                    {
+                    for (auto &[w, value] : windows)
+                    {
+                        m.insert(w, value);
+                    } });
+                build.heap_bytes = bench::heap_bytes() - heap_before;
+                bench::report(build);
+
+                bench::result stab{"interval", "containing", "interval_treemap", n, points.size()};
+                stab.seconds = bench::time_seconds([&]
+                                                   {
+                    for (int p : points)
+                    {
+                        m.containing(p, [&](const window &, int value)
+                                     { found += value; });
+                    } });
+                bench::report(stab);
+
+                bench::result overlap{"interval", "overlapping_100", "interval_treemap", n, points.size()};
+                overlap.seconds = bench::time_seconds([&]
+                                                      {
+                    for (int p : points)
+                    {
+                        found += long(m.count_overlapping(p, p + 100));
+                    } });
+                bench::report(overlap);
+            }
+            {
+                my::interval_treemap<int, int> m;
+                bench::result load{"interval", "insert_sorted", "interval_treemap", n, n};
+                load.seconds = bench::time_seconds([&]
+                                                   { m.insert_sorted(windows.begin(), windows.end()); });
+                bench::report(load);
+            }
+            {
+                // what we had: ordered by start, every window that starts before t is a candidate
+                std::vector<std::pair<std::pair<int, int>, int>> pairs;
+                for (auto &[w, value] : windows)
+                {
+                    pairs.push_back({{w.start, w.end}, value});
+                }
+                my::treemap<std::pair<int, int>, int> m;
+                bench::result build{"interval", "insert_sorted", "treemap", n, n};
+                build.seconds = bench::time_seconds([&]
+                                                    { m.insert_or_assign_sorted(pairs.begin(), pairs.end()); });
+                bench::report(build);
+
+                bench::result stab{"interval", "containing", "treemap scan", n, scans};
+                stab.seconds = bench::time_seconds([&]
+                                                   {
+                    for (size_t i = 0; i < scans; i++)
+                    {
+                        int p = points[i];
+                        for (auto it = m.begin(); it != m.end() && it->first.first <= p; ++it)
+                        {
+                            found += p < it->first.second ? it->second : 0;
+                        }
+                    } });
+                bench::report(stab);
+            }
+            bench::do_not_optimize(found);
+        }
+    }
+
+    bench::register_suite reg("interval", interval_suite);
+
+} // namespace
@@ -0,0 +1,99 @@
+// benchmark suite "iterate": full forward and reverse traversals and iterator copies
+// treemap (plain pointer iterators, reverse_iterator) against compact_treemap and std::map
+// keys inserted in random order, sizes 1K .. 10M (limited by --max-size)
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "compact_treemap.h"
+
+namespace
+{
+
+    // full passes over maps of this many elements per timed run
+    const size_t elements_per_run = 10000000;
+
+    template <typename Map>
+    void run(const char *name, size_t n, const std::vector<int> &keys)
+    {
+        Map m;
+        for (int k : keys)
+        {
+            m[k] = k;
+        }
+        size_t passes = std::max<size_t>(1, elements_per_run / n);
+
+        bench::result forward{"iterate", "range_for", name, n, passes * n};
+        int64_t sum = 0;
+        forward.seconds = bench::time_seconds([&]
+                                              {
+            for (size_t p = 0; p < passes; p++)
+            {
+                for (const auto &element : m)
+                {
+                    sum += element.second;
+                }
+            } });
+        bench::do_not_optimize(sum);
+        bench::report(forward);
+
+        // a decrement needs the same parent links; compact_treemap has no reverse iterators
+        if constexpr (requires { m.rbegin(); })
+        {
+            bench::result backward{"iterate", "reverse", name, n, passes * n};
+            backward.seconds = bench::time_seconds([&]
+                                                   {
+                for (size_t p = 0; p < passes; p++)
+                {
+                    for (auto it = m.rbegin(); it != m.rend(); ++it)
+                    {
+                        sum += it->second;
+                    }
+                } });
+            bench::do_not_optimize(sum);
+            bench::report(backward);
+        }
+
+        // iterators kept in a container, e.g. as positions of an index
+        bench::result copies{"iterate", "copy_iterators", name, n, passes * n};
+        std::vector<typename Map::iterator> positions;
+        positions.reserve(n);
+        copies.seconds = bench::time_seconds([&]
+                                             {
+            for (size_t p = 0; p < passes; p++)
+            {
+                positions.clear();
+                for (auto it = m.begin(); it != m.end(); ++it)
+                {
+                    positions.push_back(it);
+                }
+            } });
+        bench::do_not_optimize(positions.data());
+        bench::report(copies);
+    }
+
+    void iterate(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {1000, 100000, 1000000, 10000000}))
+        {
+            std::vector<int> keys(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                keys[i] = int(i);
+            }
+            std::shuffle(keys.begin(), keys.end(), std::mt19937(opt.seed));
+
+            run<my::treemap<int, int>>("treemap", n, keys);
+            run<my::compact_treemap<int, int>>("compact_treemap", n, keys);
+            run<std::map<int, int>>("std::map", n, keys);
+        }
+    }
+
+    bench::register_suite reg("iterate", iterate);
+
+} // namespace
@@ -0,0 +1,115 @@
+// benchmark suite "load": bulk load of a treemap<int64_t, int64_t> from a CSV and a binary file
+// line by line with getline and operator[] against load_text/load_binary on one and on all threads
+// files go to a fresh directory below /tmp (or $TMPDIR), removed afterwards
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "treemap_loader.h"
+
+namespace
+{
+
+    using map_type = my::treemap<int64_t, int64_t>;
+
+    std::string fresh_directory()
+    {
+        const char *tmp = std::getenv("TMPDIR");
+        std::string pattern = std::string(tmp != nullptr ? tmp : "/tmp") + "/treemap_bench_XXXXXX";
+        return mkdtemp(pattern.data());
+    }
+
+    std::string throughput(size_t bytes, size_t rows, double seconds)
+    {
+        char note[64];
+        std::snprintf(note, sizeof note, "%.0f MB/s, %.2f Mrows/s", double(bytes) / 1e6 / seconds, double(rows) / 1e6 / seconds);
+        return note;
+    }
+
+    template <typename Load>
+    void load_run(const char *workload, const char *name, size_t n, Load load)
+    {
+        bench::result r{"load", workload, name, n, n};
+        size_t size = 0;
+        my::load_result loaded;
+        r.seconds = bench::time_seconds([&]
+                                        {
+            map_type m;
+            loaded = load(m);
+            size = m.size(); });
+        r.note = throughput(loaded.bytes, loaded.rows, r.seconds);
+        bench::do_not_optimize(size);
+        bench::report(r);
+    }
+
+    void load(const bench::options &opt)
+    {
+        unsigned all = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t n : bench::sizes(opt, {1000000, 10000000}))
+        {
+            std::string dir = fresh_directory();
+            std::string csv = dir + "/data.csv";
+            std::string bin = dir + "/data.bin";
+            {
+                std::mt19937_64 rng(opt.seed);
+                std::ofstream text(csv);
+                std::ofstream binary(bin, std::ios::binary);
+                for (size_t i = 0; i < n; i++)
+                {
+                    int64_t key = int64_t(rng() >> 16);
+                    int64_t value = int64_t(i);
+                    text << key << ',' << value << '\n';
+                    binary.write(reinterpret_cast<const char *>(&key), sizeof key);
+                    binary.write(reinterpret_cast<const char *>(&value), sizeof value);
+                }
+            }
+
+            // the loop every caller writes by hand
+            load_run("csv", "getline+operator[]", n, [&](map_type &m)
+                     {
+                my::load_result result;
+                std::ifstream in(csv);
+                std::string line;
+                while (std::getline(in, line))
+                {
+                    size_t sep = line.find(',');
+                    int64_t key = 0, value = 0;
+                    std::from_chars(line.data(), line.data() + sep, key);
+                    std::from_chars(line.data() + sep + 1, line.data() + line.size(), value);
+                    m[key] = value;
+                    result.rows++;
+                }
+                result.bytes = std::filesystem::file_size(csv);
+                return result; });
+            load_run("csv", "load_text 1 thread", n, [&](map_type &m)
+                     { return my::load_text(csv, m, {1}); });
+            if (all > 1)
+            {
+                load_run("csv", ("load_text " + std::to_string(all) + " threads").c_str(), n, [&](map_type &m)
+                         { return my::load_text(csv, m, {all}); });
+            }
+            load_run("binary", "load_binary 1 thread", n, [&](map_type &m)
+                     { return my::load_binary(bin, m, {1}); });
+            if (all > 1)
+            {
+                load_run("binary", ("load_binary " + std::to_string(all) + " threads").c_str(), n, [&](map_type &m)
+                         { return my::load_binary(bin, m, {all}); });
+            }
+
+            std::filesystem::remove_all(dir);
+        }
+    }
+
+    bench::register_suite reg("load", load);
+
+} // namespace
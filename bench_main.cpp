@@ -0,0 +1,221 @@
+// treemap_bench - runs the registered benchmark suites
+// usage: treemap_bench [--max-size N] [--seed S] [--json FILE] [suite...]
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+#include <malloc.h>
+
+#include "bench.h"
+
+// count live heap bytes by hooking the global allocation functions
+// malloc_usable_size lets unsized delete subtract exactly what new added
+// atomic: some suites allocate on background threads
+
+static std::atomic<size_t> live_bytes{0};
+
+// out of line, so the compiler does not pair the free() inlined into operator delete with
+// operator new and warn about mismatched allocation functions (-Wmismatched-new-delete)
+[[gnu::noinline]] static void *counted_malloc(std::size_t size)
+{
+    return std::malloc(size);
+}
+
+[[gnu::noinline]] static void counted_free(void *p)
+{
+    std::free(p);
+}
+
+void *operator new(std::size_t size)
+{
+    void *p = counted_malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    live_bytes.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    if (p != nullptr)
+    {
+        live_bytes.fetch_sub(malloc_usable_size(p), std::memory_order_relaxed);
+        counted_free(p);
+    }
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+namespace bench
+{
+
+    // everything reported so far, for the JSON output
+    static std::vector<result> all_results;
+
+    size_t heap_bytes()
+    {
+        return live_bytes.load(std::memory_order_relaxed);
+    }
+
+    // VmHWM ("high water mark") from /proc/self/status
+    size_t peak_rss()
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+        {
+            if (line.compare(0, 6, "VmHWM:") == 0)
+            {
+                return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+            }
+        }
+        return 0;
+    }
+
+    // writing 5 to clear_refs resets VmHWM to the current RSS (Linux 4.0+)
+    void reset_peak_rss()
+    {
+        // hand freed memory back to the OS first, so the previous run does not count
+        malloc_trim(0);
+        std::ofstream clear_refs("/proc/self/clear_refs");
+        clear_refs << "5" << std::endl;
+    }
+
+    void report(const result &r)
+    {
+        double ns_per_op = r.ops == 0 ? 0 : r.seconds * 1e9 / r.ops;
+        double mops = r.seconds == 0 ? 0 : r.ops / r.seconds / 1e6;
+        std::printf("%-14s %-14s %-16s %10zu %10.1f ns/op %9.2f Mops/s", r.suite.c_str(), r.workload.c_str(),
+                    r.container.c_str(), r.n, ns_per_op, mops);
+        if (r.heap_bytes != 0)
+        {
+            std::printf(" %9.1f MB", r.heap_bytes / (1024.0 * 1024.0));
+        }
+        if (r.peak_rss != 0)
+        {
+            std::printf(" rss %7.1f MB", r.peak_rss / (1024.0 * 1024.0));
+        }
+        if (!r.note.empty())
+        {
+            std::printf("  %s", r.note.c_str());
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+
+        all_results.push_back(r);
+    }
+
+    static std::string json_string(const std::string &text)
+    {
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted += '\\';
+            }
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    // one object per result, numbers in base units (seconds, bytes)
+    static bool write_json(const options &opt, const std::string &file)
+    {
+        std::ofstream out(file);
+        out << "{\n  \"benchmark\": \"treemap_bench\",\n"
+            << "  \"seed\": " << opt.seed << ",\n"
+            << "  \"max_size\": " << opt.max_size << ",\n"
+            << "  \"results\": [";
+        for (size_t i = 0; i < all_results.size(); i++)
+        {
+            const result &r = all_results[i];
+            double ns_per_op = r.ops == 0 ? 0 : r.seconds * 1e9 / r.ops;
+            double ops_per_second = r.seconds == 0 ? 0 : r.ops / r.seconds;
+            out << (i == 0 ? "\n" : ",\n")
+                << "    {\"suite\": " << json_string(r.suite)
+                << ", \"workload\": " << json_string(r.workload)
+                << ", \"container\": " << json_string(r.container)
+                << ", \"n\": " << r.n
+                << ", \"ops\": " << r.ops
+                << ", \"seconds\": " << r.seconds
+                << ", \"ns_per_op\": " << ns_per_op
+                << ", \"ops_per_second\": " << ops_per_second
+                << ", \"heap_bytes\": " << r.heap_bytes
+                << ", \"peak_rss_bytes\": " << r.peak_rss
+                << ", \"note\": " << json_string(r.note) << "}";
+        }
+        out << "\n  ]\n}\n";
+        return bool(out);
+    }
+
+} // namespace bench
+
+int main(int argc, char *argv[])
+{
+    bench::options opt;
+    std::vector<std::string> selected;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc)
+        {
+            opt.max_size = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            opt.seed = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+        {
+            opt.json_file = argv[++i];
+        }
+        else if (argv[i][0] == '-')
+        {
+            std::cerr << "usage: " << argv[0] << " [--max-size N] [--seed S] [--json FILE] [suite...]" << std::endl;
+            std::cerr << "suites:";
+            for (auto &s : bench::suites())
+            {
+                std::cerr << " " << s.first;
+            }
+            std::cerr << std::endl;
+            return 1;
+        }
+        else
+        {
+            selected.push_back(argv[i]);
+        }
+    }
+
+    for (auto &s : bench::suites())
+    {
+        bool run = selected.empty();
+        for (auto &name : selected)
+        {
+            run = run || name == s.first;
+        }
+        if (run)
+        {
+            s.second(opt);
+        }
+    }
+
+    if (!opt.json_file.empty() && !bench::write_json(opt, opt.json_file))
+    {
+        std::cerr << "could not write " << opt.json_file << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,169 @@
+// benchmark suite "node_memory": random lookups in large maps, nodes from malloc (make_shared)
+// against huge_page_resource with and without transparent huge pages
+// the note gives dTLB load misses per lookup (perf_event_open, "n/a" where the kernel or the
+// virtual machine does not expose the counter) and how much of the process is on huge pages
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "treemap.h"
+#include "node_memory.h"
+
+namespace
+{
+
+    // dTLB read misses of this thread, user space only
+    class dtlb_counter
+    {
+    public:
+        dtlb_counter()
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof attr);
+            attr.size = sizeof attr;
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd_ = int(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+        ~dtlb_counter()
+        {
+            if (fd_ >= 0)
+            {
+                ::close(fd_);
+            }
+        }
+
+        bool available() const { return fd_ >= 0; }
+
+        void start()
+        {
+            if (fd_ >= 0)
+            {
+                ::ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+                ::ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        long long stop()
+        {
+            long long count = 0;
+            if (fd_ >= 0)
+            {
+                ::ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+                if (::read(fd_, &count, sizeof count) != sizeof count)
+                {
+                    count = 0;
+                }
+            }
+            return count;
+        }
+
+    private:
+        int fd_ = -1;
+    };
+
+    // AnonHugePages of this process in bytes
+    size_t huge_page_bytes()
+    {
+        std::ifstream smaps("/proc/self/smaps_rollup");
+        std::string field;
+        size_t kb = 0;
+        while (smaps >> field)
+        {
+            if (field == "AnonHugePages:")
+            {
+                smaps >> kb;
+                break;
+            }
+        }
+        return kb << 10;
+    }
+
+    void lookups(const char *name, size_t n, const std::vector<int> &keys, const std::vector<int> &probes,
+                 std::pmr::memory_resource *resource)
+    {
+        size_t huge_before = huge_page_bytes();
+        my::treemap<int, int> m;
+        m.node_resource(resource);
+        for (int k : keys)
+        {
+            m[k] = k;
+        }
+        size_t huge = huge_page_bytes() - std::min(huge_before, huge_page_bytes());
+
+        dtlb_counter dtlb;
+        long sum = 0;
+        bench::result r{"node_memory", "find", name, n, probes.size()};
+        dtlb.start();
+        r.seconds = bench::time_seconds([&]
+                                        {
+            for (int k : probes)
+            {
+                auto it = m.find(k);
+                sum += it != m.end() ? it->second : 0;
+            } });
+        long long misses = dtlb.stop();
+        bench::do_not_optimize(sum);
+
+        char note[96];
+        if (dtlb.available())
+        {
+            std::snprintf(note, sizeof note, "%.2f dTLB misses/op, %zu MB on huge pages", double(misses) / double(probes.size()), huge >> 20);
+        }
+        else
+        {
+            std::snprintf(note, sizeof note, "dTLB misses n/a, %zu MB on huge pages", huge >> 20);
+        }
+        r.note = note;
+        bench::report(r);
+    }
+
+    void node_memory(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {100000, 1000000, 10000000}))
+        {
+            // random insert order: neighbours in the tree are far apart in memory either way
+            std::mt19937 rng(opt.seed);
+            std::vector<int> keys(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                keys[i] = int(2 * i);
+            }
+            std::shuffle(keys.begin(), keys.end(), rng);
+            std::vector<int> probes(1000000);
+            for (auto &k : probes)
+            {
+                k = keys[rng() % n];
+            }
+
+            lookups("treemap (malloc)", n, keys, probes, nullptr);
+            {
+                my::huge_page_options options;
+                options.huge_pages = false;
+                my::huge_page_resource pages(options);
+                lookups("huge_page_resource 4K", n, keys, probes, &pages);
+            }
+            {
+                my::huge_page_resource pages;
+                lookups("huge_page_resource THP", n, keys, probes, &pages);
+            }
+        }
+    }
+
+    bench::register_suite reg("node_memory", node_memory);
+
+} // namespace
@@ -0,0 +1,86 @@
+// benchmark suite "misses": lookups where a given fraction of the keys is not in the map
+// compares treemap, treemap with bloom filter and std::map
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+
+namespace
+{
+
+    template <typename Map>
+    bench::result run(const std::string &workload, const char *name, Map &m, size_t n, const std::vector<int> &probes)
+    {
+        bench::result r{"misses", workload, name, n, probes.size()};
+        size_t found = 0;
+        r.seconds = bench::time_seconds([&]
+                                        {
+            for (int k : probes)
+            {
+                found += m.count(k);
+            } });
+        bench::do_not_optimize(found);
+        return r;
+    }
+
+    void misses(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {10000, 100000, 1000000}))
+        {
+            std::mt19937 rng(opt.seed);
+
+            // even numbers are in the map, odd numbers are misses
+            std::vector<int> keys(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                keys[i] = int(2 * i);
+            }
+            std::shuffle(keys.begin(), keys.end(), rng);
+
+            my::treemap<int, int> plain, filtered;
+            std::map<int, int> reference;
+            filtered.bloom_filter(n);
+            for (int k : keys)
+            {
+                plain.insert(k, k);
+                filtered.insert(k, k);
+                reference.emplace(k, k);
+            }
+
+            for (int percent : {0, 50, 90})
+            {
+                size_t lookups = std::max<size_t>(n, 1000000);
+                std::vector<int> probes(lookups);
+                std::uniform_int_distribution<size_t> any(0, n - 1);
+                std::uniform_int_distribution<int> pct(0, 99);
+                for (auto &p : probes)
+                {
+                    p = int(2 * any(rng)) + (pct(rng) < percent ? 1 : 0);
+                }
+
+                std::string workload = "miss_" + std::to_string(percent) + "%";
+                bench::report(run(workload, "treemap", plain, n, probes));
+
+                filtered.reset_bloom_stats();
+                auto r = run(workload, "treemap_bloom", filtered, n, probes);
+                auto stats = filtered.bloom_stats();
+                char note[96];
+                std::snprintf(note, sizeof note, "fp rate %.4f, filter %.1f KB", stats.false_positive_rate(),
+                              stats.bytes / 1024.0);
+                r.note = note;
+                bench::report(r);
+
+                bench::report(run(workload, "std::map", reference, n, probes));
+            }
+        }
+    }
+
+    bench::register_suite reg("misses", misses);
+
+} // namespace
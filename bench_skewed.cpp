@@ -0,0 +1,78 @@
+// benchmark suite "skewed": lookups with uniform vs Zipf distributed keys
+// compares treemap, treemap with a 1024 slot front cache and std::map
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+
+namespace
+{
+
+    template <typename Map, typename Find>
+    void run(const char *workload, const char *name, Map &m, size_t n, const std::vector<int> &probes, Find find)
+    {
+        bench::result r{"skewed", workload, name, n, probes.size()};
+        size_t found = 0;
+        r.seconds = bench::time_seconds([&]
+                                        {
+            for (int k : probes)
+            {
+                found += find(m, k);
+            } });
+        bench::do_not_optimize(found);
+        bench::report(r);
+    }
+
+    void skewed(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {10000, 100000, 1000000}))
+        {
+            std::mt19937 rng(opt.seed);
+
+            // keys inserted in random order
+            std::vector<int> keys(n);
+            std::iota(keys.begin(), keys.end(), 0);
+            std::shuffle(keys.begin(), keys.end(), rng);
+
+            my::treemap<int, int> plain, cached;
+            std::map<int, int> reference;
+            cached.front_cache(1024);
+            for (int k : keys)
+            {
+                plain.insert(k, k);
+                cached.insert(k, k);
+                reference.emplace(k, k);
+            }
+
+            // the i-th hottest key is keys[i], so hot keys are scattered across the tree
+            size_t lookups = std::max<size_t>(n, 1000000);
+            std::vector<int> uniform(lookups), zipf(lookups);
+            std::uniform_int_distribution<size_t> any(0, n - 1);
+            bench::zipf_distribution hot(n, 0.99);
+            for (size_t i = 0; i < lookups; i++)
+            {
+                uniform[i] = keys[any(rng)];
+                zipf[i] = keys[hot(rng)];
+            }
+
+            auto count = [](auto &m, int k)
+            { return m.count(k); };
+
+            run("uniform", "treemap", plain, n, uniform, count);
+            run("uniform", "treemap_cache", cached, n, uniform, count);
+            run("uniform", "std::map", reference, n, uniform, count);
+            run("zipf_0.99", "treemap", plain, n, zipf, count);
+            run("zipf_0.99", "treemap_cache", cached, n, zipf, count);
+            run("zipf_0.99", "std::map", reference, n, zipf, count);
+        }
+    }
+
+    bench::register_suite reg("skewed", skewed);
+
+} // namespace
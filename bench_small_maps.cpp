@@ -0,0 +1,88 @@
+// benchmark suite "small_maps": many maps with 1..64 int keys each
+// measures create+insert, find and destroy per element for treemap, small_treemap and std::map
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "small_treemap.h"
+
+namespace
+{
+
+    // build `maps` maps of n elements each, then look up every key once, then destroy them all
+    template <typename Map, typename Insert, typename Find>
+    void run(const char *name, size_t n, size_t maps, const std::vector<int> &keys, Insert insert, Find find)
+    {
+        size_t ops = n * maps;
+        std::vector<Map> all;
+        all.reserve(maps);
+
+        bench::result create{"small_maps", "create_insert", name, n, ops};
+        create.seconds = bench::time_seconds([&]
+                                             {
+            for (size_t m = 0; m < maps; m++)
+            {
+                all.emplace_back();
+                for (size_t i = 0; i < n; i++)
+                {
+                    insert(all.back(), keys[i]);
+                }
+            } });
+        bench::report(create);
+
+        bench::result lookup{"small_maps", "find", name, n, ops};
+        size_t found = 0;
+        lookup.seconds = bench::time_seconds([&]
+                                             {
+            for (auto &map : all)
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    found += find(map, keys[i]);
+                }
+            } });
+        bench::do_not_optimize(found);
+        bench::report(lookup);
+
+        bench::result destroy{"small_maps", "destroy", name, n, ops};
+        destroy.seconds = bench::time_seconds([&]
+                                              { all.clear(); });
+        bench::report(destroy);
+    }
+
+    void small_maps(const bench::options &opt)
+    {
+        // total number of elements per measurement, spread over many maps
+        size_t total = std::min<size_t>(opt.max_size, 1000000);
+
+        for (size_t n : {1, 2, 4, 8, 16, 24, 32, 48, 64})
+        {
+            std::vector<int> keys(n);
+            std::iota(keys.begin(), keys.end(), 0);
+            std::shuffle(keys.begin(), keys.end(), std::mt19937(opt.seed));
+            size_t maps = std::max<size_t>(1, total / n);
+
+            auto insert = [](auto &m, int k)
+            { m.insert(k, k); };
+            auto find = [](auto &m, int k)
+            { return m.count(k); };
+
+            run<my::treemap<int, int>>("treemap", n, maps, keys, insert, find);
+            run<my::small_treemap<int, int, 32>>("small_treemap", n, maps, keys, insert, find);
+            run<std::map<int, int>>(
+                "std::map", n, maps, keys,
+                [](auto &m, int k)
+                { m.emplace(k, k); },
+                find);
+        }
+    }
+
+    bench::register_suite reg("small_maps", small_maps);
+
+} // namespace
@@ -0,0 +1,93 @@
+// benchmark suite "static": a fixed 256-entry lookup table
+// static_treemap (built by the compiler) against treemap and std::map filled at startup
+// startup is only measured for the latter two - the static table costs nothing at runtime
+
+#include <array>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "static_treemap.h"
+
+namespace
+{
+
+    const size_t table_size = 256;
+
+    // keys 0, 7, 14, ... in scrambled order, value = key + 1
+    constexpr std::array<std::pair<int, int>, table_size> table_entries()
+    {
+        std::array<std::pair<int, int>, table_size> entries{};
+        for (size_t i = 0; i < table_size; i++)
+        {
+            int key = int((i * 101) % table_size) * 7;
+            entries[i] = {key, key + 1};
+        }
+        return entries;
+    }
+
+    constexpr my::static_treemap<int, int, table_size> table(table_entries());
+
+    template <typename Map>
+    void lookups(const char *name, const Map &m, const std::vector<int> &probes)
+    {
+        bench::result r{"static", "find", name, table_size, probes.size()};
+        long sum = 0;
+        r.seconds = bench::time_seconds([&]
+                                        {
+            for (int k : probes)
+            {
+                auto it = m.find(k);
+                sum += it != m.end() ? it->second : 0;
+            } });
+        bench::do_not_optimize(sum);
+        bench::report(r);
+    }
+
+    template <typename Map>
+    void startup(const char *name, size_t runs, Map &m)
+    {
+        bench::result r{"static", "startup", name, table_size, runs * table_size};
+        size_t heap_before = bench::heap_bytes();
+        r.seconds = bench::time_seconds([&]
+                                        {
+            for (size_t i = 0; i < runs; i++)
+            {
+                m = Map();
+                for (const auto &[key, value] : table_entries())
+                {
+                    m[key] = value;
+                }
+            } });
+        r.heap_bytes = bench::heap_bytes() - heap_before;
+        bench::report(r);
+    }
+
+    void static_table(const bench::options &opt)
+    {
+        // half hits, half misses
+        std::vector<int> probes(std::min<size_t>(opt.max_size, 10000000));
+        std::mt19937 rng(opt.seed);
+        std::uniform_int_distribution<int> any(0, int(table_size * 7));
+        for (auto &k : probes)
+        {
+            k = any(rng);
+        }
+
+        size_t runs = 10000;
+        my::treemap<int, int> tree;
+        std::map<int, int> map;
+        startup("treemap", runs, tree);
+        startup("std::map", runs, map);
+
+        lookups("static_treemap", table, probes);
+        lookups("treemap", tree, probes);
+        lookups("std::map", map, probes);
+    }
+
+    bench::register_suite reg("static", static_table);
+
+} // namespace
@@ -0,0 +1,148 @@
+// benchmark suite "string_keys": long URL-like keys with long shared prefixes
+// compares treemap<std::string>, string_treemap and std::map
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.h"
+#include "treemap.h"
+#include "string_treemap.h"
+
+namespace
+{
+
+    // generates unique URLs the way our crawl logs look like:
+    // few schemes and hosts, a shallow path hierarchy from a small vocabulary, a numeric id and a query
+    class url_generator
+    {
+    public:
+        explicit url_generator(unsigned seed) : rng_(seed) {}
+
+        std::string operator()(size_t id)
+        {
+            static const char *hosts[] = {
+                "https://www.example-shop.com", "https://api.example-shop.com", "https://cdn.static-example.net",
+                "http://legacy.example-shop.com", "https://blog.example-media.org", "https://m.example-shop.com"};
+            static const char *segments[] = {
+                "products", "category", "electronics", "home-and-garden", "sports", "v1", "v2", "images",
+                "thumbnails", "articles", "2023", "2024", "reviews", "search", "users", "orders"};
+
+            std::string url = pick(hosts);
+            size_t depth = 1 + rng_() % 4;
+            for (size_t i = 0; i < depth; i++)
+            {
+                url += '/';
+                url += pick(segments);
+            }
+            url += "/item-";
+            url += std::to_string(id);
+            if (rng_() % 2 == 0)
+            {
+                url += "?ref=campaign&utm_source=newsletter";
+            }
+            return url;
+        }
+
+    private:
+        template <size_t N>
+        const char *pick(const char *(&choices)[N]) { return choices[rng_() % N]; }
+
+        std::mt19937 rng_;
+    };
+
+    // run the workloads for one container type
+    // insert(map, key, value) adds an element, find(map, key) returns 1 on a hit and 0 on a miss
+    template <typename Map, typename Insert, typename Find>
+    void run(const char *name, size_t n, const std::vector<std::string> &keys, const std::vector<std::string> &misses,
+             Insert insert, Find find)
+    {
+        size_t heap_before = bench::heap_bytes();
+        {
+            Map m;
+            bench::result r{"string_keys", "insert", name, n, n};
+            r.seconds = bench::time_seconds([&]
+                                            {
+                for (const auto &k : keys)
+                {
+                    insert(m, k, 1);
+                } });
+            r.heap_bytes = bench::heap_bytes() - heap_before;
+            bench::report(r);
+
+            bench::result hit{"string_keys", "find_hit", name, n, n};
+            size_t found = 0;
+            hit.seconds = bench::time_seconds([&]
+                                              {
+                for (const auto &k : keys)
+                {
+                    found += find(m, std::string_view(k));
+                } });
+            bench::do_not_optimize(found);
+            bench::report(hit);
+
+            bench::result miss{"string_keys", "find_miss", name, n, n};
+            miss.seconds = bench::time_seconds([&]
+                                               {
+                for (const auto &k : misses)
+                {
+                    found += find(m, std::string_view(k));
+                } });
+            bench::do_not_optimize(found);
+            bench::report(miss);
+
+            bench::result iter{"string_keys", "iterate", name, n, n};
+            size_t total = 0;
+            iter.seconds = bench::time_seconds([&]
+                                               {
+                for (auto it = m.begin(); it != m.end(); ++it)
+                {
+                    total += (*it).first.size();
+                } });
+            bench::do_not_optimize(total);
+            bench::report(iter);
+        }
+    }
+
+    void string_keys(const bench::options &opt)
+    {
+        for (size_t n : bench::sizes(opt, {10000, 100000, 1000000}))
+        {
+            url_generator gen(opt.seed);
+            std::vector<std::string> keys, misses;
+            keys.reserve(n);
+            misses.reserve(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                keys.push_back(gen(i));
+                misses.push_back(gen(n + i));
+            }
+            std::shuffle(keys.begin(), keys.end(), std::mt19937(opt.seed));
+
+            run<my::treemap<std::string, int, std::less<>>>(
+                "treemap", n, keys, misses,
+                [](auto &m, const std::string &k, int v)
+                { m.insert(k, v); },
+                [](auto &m, std::string_view k)
+                { return m.count(k); });
+            run<my::string_treemap<int>>(
+                "string_treemap", n, keys, misses,
+                [](auto &m, const std::string &k, int v)
+                { m.insert(k, v); },
+                [](auto &m, std::string_view k)
+                { return m.count(k); });
+            run<std::map<std::string, int, std::less<>>>(
+                "std::map", n, keys, misses,
+                [](auto &m, const std::string &k, int v)
+                { m.emplace(k, v); },
+                [](auto &m, std::string_view k)
+                { return (size_t)(m.find(k) != m.end()); });
+        }
+    }
+
+    bench::register_suite reg("string_keys", string_keys);
+
+} // namespace
@@ -0,0 +1,136 @@
+// blocked bloom filter - answers "definitely not contained" for most absent keys
+// used by treemap to skip the descent into the tree for lookups that will miss
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace my
+{
+
+    // counters of a treemap's bloom filter
+    struct bloom_filter_stats
+    {
+        size_t queries = 0;         // lookups that consulted the filter
+        size_t negatives = 0;       // lookups the filter answered "not contained"
+        size_t false_positives = 0; // lookups the filter let through, but the key was not in the tree
+        size_t bytes = 0;           // memory used by the filter bits
+
+        // fraction of lookups for absent keys that were not rejected by the filter
+        double false_positive_rate() const
+        {
+            size_t absent = negatives + false_positives;
+            return absent == 0 ? 0.0 : double(false_positives) / double(absent);
+        }
+    };
+
+    /*
+     * class blocked_bloom_filter
+     * bloom filter whose bits for one key all lie in the same 64 byte block,
+     * so every query touches exactly one cache line
+     * - no false negatives: may_contain() is true for every key that was added
+     * - keys are given as (any quality) hash values, they are remixed internally
+     * - bits cannot be removed, rebuild the filter to forget keys
+     */
+    class blocked_bloom_filter
+    {
+    public:
+        // filter sized for expected_keys with bits_per_key bits each (10 bits: about 1% false positives)
+        explicit blocked_bloom_filter(size_t expected_keys, size_t bits_per_key = 10)
+            : blocks_((expected_keys * bits_per_key + block_bits - 1) / block_bits + 1),
+              capacity_(expected_keys), bits_per_key_(bits_per_key)
+        {
+            // k = ln 2 * bits per key is optimal for a plain bloom filter; blocking favours slightly fewer
+            probes_ = bits_per_key * 2 / 3;
+            if (probes_ < 1)
+            {
+                probes_ = 1;
+            }
+            if (probes_ > 8)
+            {
+                probes_ = 8;
+            }
+        }
+
+        void add(size_t hash)
+        {
+            uint64_t h = mix(hash);
+            block &b = blocks_[block_index(h)];
+            uint64_t g = h * 0x9e3779b97f4a7c15ULL;
+            uint32_t h1 = uint32_t(g);
+            uint32_t h2 = uint32_t(g >> 32) | 1;
+            for (unsigned i = 0; i < probes_; i++)
+            {
+                uint32_t bit = (h1 + i * h2) % block_bits;
+                b.words_[bit / 64] |= uint64_t(1) << (bit % 64);
+            }
+        }
+
+        bool may_contain(size_t hash) const
+        {
+            uint64_t h = mix(hash);
+            const block &b = blocks_[block_index(h)];
+            uint64_t g = h * 0x9e3779b97f4a7c15ULL;
+            uint32_t h1 = uint32_t(g);
+            uint32_t h2 = uint32_t(g >> 32) | 1;
+            for (unsigned i = 0; i < probes_; i++)
+            {
+                uint32_t bit = (h1 + i * h2) % block_bits;
+                if ((b.words_[bit / 64] & (uint64_t(1) << (bit % 64))) == 0)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // forget all keys
+        void clear()
+        {
+            for (auto &b : blocks_)
+            {
+                b = block();
+            }
+        }
+
+        // number of keys the filter was sized for
+        size_t capacity() const { return capacity_; }
+
+        size_t bits_per_key() const { return bits_per_key_; }
+
+        size_t bytes() const { return blocks_.size() * sizeof(block); }
+
+    private:
+        static constexpr uint32_t block_bits = 512;
+
+        struct alignas(64) block
+        {
+            uint64_t words_[8] = {};
+        };
+
+        // std::hash is the identity for integers, spread the bits first (murmur3 finalizer)
+        static uint64_t mix(uint64_t h)
+        {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+
+        // map the hash onto the blocks without a division (multiply-shift range reduction)
+        size_t block_index(uint64_t h) const
+        {
+            return size_t((unsigned __int128)h * blocks_.size() >> 64);
+        }
+
+        std::vector<block> blocks_;
+        size_t capacity_;
+        size_t bits_per_key_;
+        unsigned probes_;
+    };
+
+} // namespace my
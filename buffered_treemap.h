@@ -0,0 +1,157 @@
+// buffered_treemap - treemap with a sorted write buffer in front, for ingest bursts
+// writes collect in a small sorted array, full buffers are merged into the tree in one sorted pass
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "treemap.h"
+
+namespace my
+{
+
+    /*
+     * class buffered_treemap<K,T,Compare>
+     * treemap plus a sorted write buffer (an LSM-tree with one level)
+     * - insert/insert_or_assign go into the buffer: a binary search and a shift inside a few KB,
+     *   instead of a descent with cache misses all the way through a large tree
+     * - a full buffer is merged with treemap::insert_sorted_, which walks on from one key to the
+     *   next: nodes shared by neighbouring paths are visited once per merge, not once per key
+     * - lookups check the buffer first, then the tree
+     * - writes do not report whether the key was new (that would need the descent they avoid);
+     *   size() and map() merge the buffer first
+     * - references returned by operator[] stay valid until the next write
+     */
+    template <typename K, typename T, typename Compare = std::less<K>>
+    class buffered_treemap
+    {
+    public:
+        // public type aliases
+        using key_type = K;
+        using mapped_type = T;
+        using value_type = std::pair<K, T>;
+        using key_compare = Compare;
+        using map_type = my::treemap<K, T, Compare>;
+
+        // buffer of capacity (> 0) elements
+        explicit buffered_treemap(size_t capacity = 1024)
+            : capacity_(capacity)
+        {
+            assert(capacity > 0);
+            buffer_.reserve(capacity);
+        }
+
+        // number of keys in map (merges the buffer)
+        size_t size()
+        {
+            flush();
+            return tree_.size();
+        }
+
+        // elements waiting in the buffer
+        size_t buffered() const { return buffer_.size(); }
+
+        // how often is the element contained in the map? (0 or 1)
+        size_t count(const K &key) const { return find(key) != nullptr ? 1 : 0; }
+
+        // value of key, nullptr if not contained
+        const T *find(const K &key) const
+        {
+            auto pos = lower_bound_(key);
+            if (pos != buffer_.end() && !comp_(key, pos->first))
+            {
+                // an insert does not win over a key that is already in the tree
+                if (!pos->assign_)
+                {
+                    auto it = tree_.find(key);
+                    if (it != tree_.end())
+                    {
+                        return &it->second;
+                    }
+                }
+                return &pos->second;
+            }
+            auto it = tree_.find(key);
+            return it != tree_.end() ? &it->second : nullptr;
+        }
+
+        // random read/write access to value by key, inserts T() if key is missing
+        T &operator[](const K &key)
+        {
+            if (const T *found = find(key))
+            {
+                return const_cast<T &>(*found);
+            }
+            // known to be new, so the entry may overwrite
+            return write_(key, T(), true)->second;
+        }
+
+        // insert if key is missing (decided when the buffer is merged)
+        void insert(const K &key, const T &value) { write_(key, value, false); }
+
+        void insert_or_assign(const K &key, const T &value) { write_(key, value, true); }
+
+        // merge the buffer into the tree
+        void flush()
+        {
+            tree_.insert_sorted_(buffer_.begin(), buffer_.end(), [](const entry &e)
+                                 { return e.assign_; });
+            buffer_.clear();
+        }
+
+        // the tree with all writes merged, e.g. for iteration
+        map_type &map()
+        {
+            flush();
+            return tree_;
+        }
+
+    protected:
+        // buffered write; first/second like value_type, so insert_sorted_ can read it
+        struct entry
+        {
+            K first;
+            T second;
+            bool assign_; // insert_or_assign (true) or insert (false)
+        };
+
+        size_t capacity_;
+        std::vector<entry> buffer_; // sorted by key, no duplicates
+        map_type tree_;
+        [[no_unique_address]] Compare comp_;
+
+        typename std::vector<entry>::const_iterator lower_bound_(const K &key) const
+        {
+            return std::lower_bound(buffer_.begin(), buffer_.end(), key,
+                                    [this](const entry &e, const K &k)
+                                    { return comp_(e.first, k); });
+        }
+
+        // add or update the buffer entry of key, merging a full buffer first
+        entry *write_(const K &key, const T &value, bool assign)
+        {
+            auto pos = buffer_.begin() + (lower_bound_(key) - buffer_.cbegin());
+            if (pos != buffer_.end() && !comp_(key, pos->first))
+            {
+                // a second insert of a buffered key changes nothing, like in the tree
+                if (assign)
+                {
+                    pos->second = value;
+                    pos->assign_ = true;
+                }
+                return &*pos;
+            }
+            if (buffer_.size() >= capacity_)
+            {
+                flush();
+                pos = buffer_.begin();
+            }
+            return &*buffer_.insert(pos, entry{key, value, assign});
+        }
+    };
+
+} // namespace my
@@ -0,0 +1,370 @@
+// cache_treemap - treemap with per-entry expiry and a size/memory budget, for cache-style use
+// expired and surplus entries are removed a few at a time during writes, never in one sweep
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "treemap.h"
+
+namespace my
+{
+
+    // which entry goes first when the cache is over budget
+    enum class cache_eviction
+    {
+        lru,  // least recently used: find() and operator[] move an entry to the front
+        fifo, // oldest write first, lookups change nothing
+    };
+
+    struct cache_options
+    {
+        size_t max_size = 0;  // entries, 0: unbounded
+        size_t max_bytes = 0; // estimated bytes of all entries (see cache_treemap::bytes), 0: unbounded
+        cache_eviction eviction = cache_eviction::lru;
+        bool hash_index = false; // treemap::hash_index for the lookups
+    };
+
+    /*
+     * class cache_treemap<K,T,Compare,Clock>
+     * ordered map whose entries may expire and which never grows past its budget
+     * - an entry written with a time to live is gone after it: lookups do not see it, and it is
+     *   removed by the lookup that finds it or by a later write, whichever comes first
+     * - every write removes at most max_expire_per_write expired entries (a min-heap of expiry
+     *   times) and then evicts the least recently used (or oldest) entries until the cache is
+     *   within max_size/max_bytes again - a constant amount of work per write in a steady state,
+     *   and memory stays flat under sustained load
+     * - recency is an intrusive list through the entries, which works because treemap never
+     *   moves a node (erase relinks nodes instead of copying values); no snapshots of the tree
+     * - bytes are estimated: a node of the tree, the heap slot, plus what the optional weigher
+     *   says for key and value (e.g. their heap memory)
+     * - Clock is a std::chrono clock; now() is only called for entries that can expire
+     */
+    template <typename K, typename T, typename Compare = std::less<K>, typename Clock = std::chrono::steady_clock>
+    class cache_treemap
+    {
+    public:
+        // public type aliases
+        using key_type = K;
+        using mapped_type = T;
+        using key_compare = Compare;
+        using clock = Clock;
+        using time_point = typename Clock::time_point;
+        using duration = typename Clock::duration;
+        using weigher = std::function<size_t(const K &, const T &)>;
+
+        // expired entries removed per write, at most
+        static const size_t max_expire_per_write = 2;
+
+        explicit cache_treemap(const cache_options &options = cache_options(), weigher weigh = nullptr)
+            : options_(options), weigh_(std::move(weigh))
+        {
+            if (options_.hash_index)
+            {
+                tree_.hash_index(true);
+            }
+            entry_bytes_ = tree_.shape_stats().bytes_per_node + sizeof(entry *);
+        }
+
+        // the entries point at each other
+        cache_treemap(const cache_treemap &) = delete;
+        cache_treemap &operator=(const cache_treemap &) = delete;
+
+        // entries in the map, expired ones included until they are removed
+        size_t size() const { return tree_.size(); }
+
+        // estimated memory of all entries
+        size_t bytes() const { return bytes_; }
+
+        const cache_options &options() const { return options_; }
+
+        // entries removed because of the budget / because they expired
+        size_t evictions() const { return evictions_; }
+        size_t expirations() const { return expirations_; }
+
+        // how often is the (not expired) element contained in the map? (0 or 1)
+        size_t count(const K &key) const
+        {
+            auto it = tree_.find(key);
+            return it != tree_.end() && !expired_(it->second) ? 1 : 0;
+        }
+
+        // value of key, nullptr if missing or expired; counts as a use for lru
+        T *find(const K &key)
+        {
+            auto it = tree_.find(key);
+            if (it == tree_.end())
+            {
+                return nullptr;
+            }
+            entry &e = it->second;
+            if (expired_(e))
+            {
+                remove_(e);
+                expirations_++;
+                return nullptr;
+            }
+            if (options_.eviction == cache_eviction::lru)
+            {
+                unlink_(e);
+                link_front_(e);
+            }
+            return &e.value_;
+        }
+
+        // random read/write access to value by key, inserts T() (never expiring) if key is missing
+        // the reference is valid until the next write
+        T &operator[](const K &key)
+        {
+            if (T *found = find(key))
+            {
+                return *found;
+            }
+            return write_(key, T(), time_point::max())->value_;
+        }
+
+        // insert or overwrite, the entry does not expire
+        void insert_or_assign(const K &key, const T &value) { write_(key, value, time_point::max()); }
+
+        // insert or overwrite, the entry expires after ttl
+        void insert_or_assign(const K &key, const T &value, duration ttl) { write_(key, value, Clock::now() + ttl); }
+
+        // remove the element with this key, returns the number of removed elements (0 or 1)
+        size_t erase(const K &key)
+        {
+            auto it = tree_.find(key);
+            if (it == tree_.end())
+            {
+                return 0;
+            }
+            remove_(it->second);
+            return 1;
+        }
+
+        void clear()
+        {
+            tree_.clear();
+            expiring_.clear();
+            newest_ = oldest_ = nullptr;
+            bytes_ = 0;
+        }
+
+        // remove up to max_entries expired entries (with no writes coming, nothing else does)
+        // returns the number removed
+        size_t expire(size_t max_entries = size_t(-1))
+        {
+            size_t removed = 0;
+            if (expiring_.empty())
+            {
+                return 0;
+            }
+            time_point now = Clock::now();
+            while (removed < max_entries && !expiring_.empty() && expiring_[0]->expires_ <= now)
+            {
+                remove_(*expiring_[0]);
+                removed++;
+            }
+            expirations_ += removed;
+            return removed;
+        }
+
+        // f(key, value) for every entry that has not expired, in key order
+        template <typename F>
+        void for_each(F f) const
+        {
+            time_point now = expiring_.empty() ? time_point() : Clock::now();
+            for (const auto &[key, e] : tree_)
+            {
+                if (e.expires_ == time_point::max() || e.expires_ > now)
+                {
+                    f(key, e.value_);
+                }
+            }
+        }
+
+    protected:
+        static const size_t never = size_t(-1); // heap position of an entry that does not expire
+
+        struct entry
+        {
+            T value_;
+            time_point expires_ = time_point::max();
+            entry *newer_ = nullptr; // recency list, newest_ ... oldest_
+            entry *older_ = nullptr;
+            size_t heap_ = never; // position in expiring_
+            const K *key_ = nullptr;
+            size_t bytes_ = 0;
+        };
+
+        cache_options options_;
+        weigher weigh_;
+        treemap<K, entry, Compare> tree_;
+        entry *newest_ = nullptr;
+        entry *oldest_ = nullptr;
+        std::vector<entry *> expiring_; // min-heap by expires_
+        size_t entry_bytes_;            // bytes of an entry without the weigher's part
+        size_t bytes_ = 0;
+        size_t evictions_ = 0;
+        size_t expirations_ = 0;
+
+        bool expired_(const entry &e) const
+        {
+            return e.expires_ != time_point::max() && e.expires_ <= Clock::now();
+        }
+
+        bool over_budget_() const
+        {
+            return (options_.max_size > 0 && tree_.size() > options_.max_size) ||
+                   (options_.max_bytes > 0 && bytes_ > options_.max_bytes);
+        }
+
+        entry *write_(const K &key, const T &value, time_point expires)
+        {
+            auto [it, inserted] = tree_.insert(key, entry{value});
+            entry &e = it->second;
+            if (inserted)
+            {
+                e.key_ = &it->first;
+            }
+            else
+            {
+                e.value_ = value;
+                bytes_ -= e.bytes_;
+                unlink_(e);
+            }
+            e.bytes_ = entry_bytes_ + (weigh_ ? weigh_(key, e.value_) : 0);
+            bytes_ += e.bytes_;
+            link_front_(e);
+            set_expiry_(e, expires);
+
+            // amortized cleanup: a few expired entries, then the budget; never the entry just written
+            if (!expiring_.empty())
+            {
+                time_point now = Clock::now();
+                for (size_t i = 0; i < max_expire_per_write && !expiring_.empty() &&
+                                   expiring_[0]->expires_ <= now && expiring_[0] != &e;
+                     i++)
+                {
+                    remove_(*expiring_[0]);
+                    expirations_++;
+                }
+            }
+            while (over_budget_() && oldest_ != &e)
+            {
+                remove_(*oldest_);
+                evictions_++;
+            }
+            return &e;
+        }
+
+        void remove_(entry &e)
+        {
+            unlink_(e);
+            if (e.heap_ != never)
+            {
+                heap_erase_(e.heap_);
+            }
+            bytes_ -= e.bytes_;
+            tree_.erase(*e.key_);
+        }
+
+        // recency list
+
+        void link_front_(entry &e)
+        {
+            e.newer_ = nullptr;
+            e.older_ = newest_;
+            (newest_ ? newest_->newer_ : oldest_) = &e;
+            newest_ = &e;
+        }
+
+        void unlink_(entry &e)
+        {
+            (e.newer_ ? e.newer_->older_ : newest_) = e.older_;
+            (e.older_ ? e.older_->newer_ : oldest_) = e.newer_;
+            e.newer_ = e.older_ = nullptr;
+        }
+
+        // expiry heap, every entry knows its position
+
+        void set_expiry_(entry &e, time_point expires)
+        {
+            e.expires_ = expires;
+            if (expires == time_point::max())
+            {
+                if (e.heap_ != never)
+                {
+                    heap_erase_(e.heap_);
+                }
+            }
+            else if (e.heap_ == never)
+            {
+                expiring_.push_back(&e);
+                e.heap_ = expiring_.size() - 1;
+                heap_up_(e.heap_);
+            }
+            else
+            {
+                heap_down_(heap_up_(e.heap_));
+            }
+        }
+
+        void heap_set_(size_t i, entry *e)
+        {
+            expiring_[i] = e;
+            e->heap_ = i;
+        }
+
+        size_t heap_up_(size_t i)
+        {
+            entry *e = expiring_[i];
+            while (i > 0 && e->expires_ < expiring_[(i - 1) / 2]->expires_)
+            {
+                heap_set_(i, expiring_[(i - 1) / 2]);
+                i = (i - 1) / 2;
+            }
+            heap_set_(i, e);
+            return i;
+        }
+
+        void heap_down_(size_t i)
+        {
+            entry *e = expiring_[i];
+            for (;;)
+            {
+                size_t child = 2 * i + 1;
+                if (child >= expiring_.size())
+                {
+                    break;
+                }
+                if (child + 1 < expiring_.size() && expiring_[child + 1]->expires_ < expiring_[child]->expires_)
+                {
+                    child++;
+                }
+                if (!(expiring_[child]->expires_ < e->expires_))
+                {
+                    break;
+                }
+                heap_set_(i, expiring_[child]);
+                i = child;
+            }
+            heap_set_(i, e);
+        }
+
+        void heap_erase_(size_t i)
+        {
+            expiring_[i]->heap_ = never;
+            entry *last = expiring_.back();
+            expiring_.pop_back();
+            if (i < expiring_.size())
+            {
+                heap_set_(i, last);
+                heap_down_(heap_up_(i));
+            }
+        }
+    };
+
+} // namespace my
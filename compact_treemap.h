@@ -0,0 +1,322 @@
+// compact_treemap - treemap whose nodes live in one vector and link by 32 bit indices
+// follows the interface of my::treemap
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// forward declarations
+
+namespace my
+{
+    template <typename K, typename T, typename Compare = std::less<K>>
+    class compact_treemap;
+}
+
+template <typename KK, typename TT, typename CC>
+void swap(my::compact_treemap<KK, TT, CC> &lhs, my::compact_treemap<KK, TT, CC> &rhs);
+
+namespace my
+{
+
+    // node of a compact_treemap: links are positions in the map's node vector
+    template <typename K, typename T>
+    struct compact_treemap_node
+    {
+        // "no node", like nullptr for treemap_node
+        static constexpr uint32_t none = UINT32_MAX;
+
+        std::pair<K, T> value_;
+        uint32_t left_ = none, right_ = none, up_ = none;
+    };
+
+    // iterator: the node vector and a position in it
+    // stays valid when the vector grows, because it does not hold an address of a node
+    template <typename K, typename T, typename Compare>
+    class compact_treemap_iterator
+    {
+    protected:
+        friend class compact_treemap<K, T, Compare>;
+
+        using node = compact_treemap_node<K, T>;
+
+        compact_treemap_iterator(std::vector<node> *nodes, uint32_t index)
+            : nodes_(nodes), index_(index) {}
+
+        std::vector<node> *nodes_;
+        uint32_t index_; // node::none for end()
+
+    public:
+        // type aliases, should be exactly the same as for treemap itself
+        using key_type = K;
+        using mapped_type = T;
+        using value_type = std::pair<K, T>;
+
+        value_type &operator*() { return (*nodes_)[index_].value_; }
+        value_type *operator->() { return &(*nodes_)[index_].value_; }
+
+        bool operator==(const compact_treemap_iterator &rhs) const { return index_ == rhs.index_ && nodes_ == rhs.nodes_; }
+        bool operator!=(const compact_treemap_iterator &rhs) const { return !(*this == rhs); }
+
+        // next element in map, pre-increment
+        compact_treemap_iterator &operator++()
+        {
+            const std::vector<node> &n = *nodes_;
+            uint32_t i = index_;
+            if (n[i].right_ != node::none)
+            {
+                // rechts und dann so weit wie möglich nach links
+                i = n[i].right_;
+                while (n[i].left_ != node::none)
+                {
+                    i = n[i].left_;
+                }
+            }
+            else
+            {
+                // nach oben, solange wir von rechts kommen
+                uint32_t parent = n[i].up_;
+                while (parent != node::none && n[parent].right_ == i)
+                {
+                    i = parent;
+                    parent = n[i].up_;
+                }
+                i = parent;
+            }
+            index_ = i;
+            return *this;
+        }
+
+        // prev element in map, pre-decrement
+        compact_treemap_iterator &operator--()
+        {
+            const std::vector<node> &n = *nodes_;
+            uint32_t i = index_;
+            if (i == node::none)
+            {
+                // end(): largest element, the root is always the first node
+                i = 0;
+                while (n[i].right_ != node::none)
+                {
+                    i = n[i].right_;
+                }
+            }
+            else if (n[i].left_ != node::none)
+            {
+                i = n[i].left_;
+                while (n[i].right_ != node::none)
+                {
+                    i = n[i].right_;
+                }
+            }
+            else
+            {
+                uint32_t parent = n[i].up_;
+                while (parent != node::none && n[parent].left_ == i)
+                {
+                    i = parent;
+                    parent = n[i].up_;
+                }
+                i = parent;
+            }
+            index_ = i;
+            return *this;
+        }
+
+    }; // class compact_treemap_iterator
+
+    /*
+     * class compact_treemap<K,T,Compare>
+     * associative container with the interface of my::treemap, for memory-constrained maps
+     * - all nodes are stored in one std::vector and link to each other by 32 bit positions
+     *   instead of shared_ptr/weak_ptr: 12 bytes of links per node instead of 64 plus a control
+     *   block and a heap allocation of its own
+     * - no balancing, no remove/erase operations (like treemap)
+     * - at most 2^32 - 1 elements, insert throws std::length_error beyond
+     * - iterators stay valid when inserting; references to elements do not (the vector may move)
+     * - copies are one vector copy, destruction never recurses
+     */
+    template <typename K, typename T, typename Compare>
+    class compact_treemap
+    {
+
+    public:
+        // public type aliases
+        using key_type = K;
+        using mapped_type = T;
+        using value_type = std::pair<K, T>;
+        using key_compare = Compare;
+        using iterator = my::compact_treemap_iterator<K, T, Compare>;
+
+    public:
+        // construct empty map
+        compact_treemap() : comp_() {}
+
+        // construct empty map using a specific comparison object
+        explicit compact_treemap(const Compare &comp) : comp_(comp) {}
+
+        // number of keys in map
+        size_t size() const { return nodes_.size(); }
+
+        // how often is the element contained in the map? (0 or 1)
+        size_t count(const K &key) const { return find_(key) == node::none ? 0 : 1; }
+
+        // random read/write access to value by key
+        // if key is not in map, insert new (key, T())
+        T &operator[](const K &key)
+        {
+            uint32_t found = find_(key);
+            if (found == node::none)
+            {
+                found = insert_(key, T()).first;
+            }
+            return nodes_[found].value_.second;
+        }
+
+        // delete all (key,value) pairs in map
+        void clear() { nodes_.clear(); }
+
+        // reserve room for n elements, inserting then never moves the nodes
+        void reserve(size_t n) { nodes_.reserve(n); }
+
+        // used for copy&move - declared in global namespace, not in my::
+        template <typename KK, typename TT, typename CC>
+        friend void ::swap(compact_treemap<KK, TT, CC> &, compact_treemap<KK, TT, CC> &);
+
+        // the comparison object used to order the keys
+        key_compare key_comp() const { return comp_; }
+
+        // bytes of the node vector (all of the map's heap memory if K and T do not allocate)
+        size_t bytes_used() const { return nodes_.capacity() * sizeof(node); }
+
+        iterator begin()
+        {
+            if (nodes_.empty())
+            {
+                return end();
+            }
+            uint32_t i = 0;
+            while (nodes_[i].left_ != node::none)
+            {
+                i = nodes_[i].left_;
+            }
+            return iterator(&nodes_, i);
+        }
+
+        iterator end() { return iterator(&nodes_, node::none); }
+
+        iterator find(const K &key) { return iterator(&nodes_, find_(key)); }
+
+        // first element whose key is not less than the given key, end() if there is none
+        iterator lower_bound(const K &key) { return iterator(&nodes_, lower_bound_(key)); }
+
+        std::pair<iterator, bool> insert(const K &key, const T &value)
+        {
+            auto result = insert_(key, value);
+            return std::make_pair(iterator(&nodes_, result.first), result.second);
+        }
+
+        std::pair<iterator, bool> insert_or_assign(const K &key, const T &value)
+        {
+            auto result = insert_(key, value);
+            if (!result.second)
+            {
+                nodes_[result.first].value_.second = value;
+            }
+            return std::make_pair(iterator(&nodes_, result.first), result.second);
+        }
+
+    protected:
+        using node = compact_treemap_node<K, T>;
+
+        // nodes in insertion order, the root is nodes_[0]
+        std::vector<node> nodes_;
+        [[no_unique_address]] Compare comp_;
+
+        // first node whose key is not less than key, node::none if there is none
+        uint32_t lower_bound_(const K &key) const
+        {
+            uint32_t current = nodes_.empty() ? node::none : 0;
+            uint32_t result = node::none;
+            while (current != node::none)
+            {
+                const node &n = nodes_[current];
+                if (!comp_(n.value_.first, key))
+                {
+                    result = current;
+                    current = n.left_;
+                }
+                else
+                {
+                    current = n.right_;
+                }
+            }
+            return result;
+        }
+
+        // node with key, node::none if not found
+        uint32_t find_(const K &key) const
+        {
+            uint32_t candidate = lower_bound_(key);
+            if (candidate != node::none && !comp_(key, nodes_[candidate].value_.first))
+            {
+                return candidate;
+            }
+            return node::none;
+        }
+
+        // (position of node with key, true if it was inserted)
+        // one comparison per node on the way down, like treemap_node::insert
+        std::pair<uint32_t, bool> insert_(const K &key, const T &mapped)
+        {
+            if (nodes_.size() >= node::none)
+            {
+                throw std::length_error("compact_treemap: more than 2^32 - 1 elements");
+            }
+
+            uint32_t parent = node::none;
+            uint32_t not_greater = node::none;
+            bool go_left = false;
+            uint32_t current = nodes_.empty() ? node::none : 0;
+            while (current != node::none)
+            {
+                parent = current;
+                go_left = comp_(key, nodes_[current].value_.first);
+                if (!go_left)
+                {
+                    not_greater = current;
+                }
+                current = go_left ? nodes_[current].left_ : nodes_[current].right_;
+            }
+
+            if (not_greater != node::none && !comp_(nodes_[not_greater].value_.first, key))
+            {
+                return std::make_pair(not_greater, false);
+            }
+
+            // link by position: push_back may move the vector, parent stays valid
+            uint32_t index = uint32_t(nodes_.size());
+            nodes_.push_back(node{value_type(key, mapped), node::none, node::none, parent});
+            if (parent != node::none)
+            {
+                (go_left ? nodes_[parent].left_ : nodes_[parent].right_) = index;
+            }
+            return std::make_pair(index, true);
+        }
+    };
+
+} // namespace my
+
+// swap contents of two maps
+// iterators keep referring to the map object they came from, so swap invalidates them
+template <typename KK, typename TT, typename CC>
+void swap(my::compact_treemap<KK, TT, CC> &lhs, my::compact_treemap<KK, TT, CC> &rhs)
+{
+    std::swap(lhs.nodes_, rhs.nodes_);
+    std::swap(lhs.comp_, rhs.comp_);
+}
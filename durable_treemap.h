@@ -0,0 +1,600 @@
+// durable_treemap - treemap whose writes survive a restart
+// write-ahead log with group commit, checkpoints from snapshots, recovery on construction
+// local files only (POSIX), one directory per map
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "treemap.h"
+
+namespace my
+{
+
+    // how keys and values are written to log and checkpoint files
+    // trivially copyable types as raw bytes, std::string length-prefixed; specialize for others
+    template <typename V, typename = void>
+    struct durable_codec;
+
+    template <typename V>
+    struct durable_codec<V, std::enable_if_t<std::is_trivially_copyable_v<V>>>
+    {
+        static void write(std::string &out, const V &value)
+        {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(V));
+        }
+
+        static bool read(const char *&p, const char *end, V &value)
+        {
+            if (size_t(end - p) < sizeof(V))
+            {
+                return false;
+            }
+            std::memcpy(&value, p, sizeof(V));
+            p += sizeof(V);
+            return true;
+        }
+    };
+
+    template <>
+    struct durable_codec<std::string>
+    {
+        static void write(std::string &out, const std::string &value)
+        {
+            durable_codec<uint32_t>::write(out, uint32_t(value.size()));
+            out += value;
+        }
+
+        static bool read(const char *&p, const char *end, std::string &value)
+        {
+            uint32_t size;
+            if (!durable_codec<uint32_t>::read(p, end, size) || size_t(end - p) < size)
+            {
+                return false;
+            }
+            value.assign(p, size);
+            p += size;
+            return true;
+        }
+    };
+
+    // when log records are forced to disk
+    enum class sync_policy
+    {
+        every_write, // write + fdatasync per write: durable when the call returns
+        group,       // records are collected and written + fdatasync'ed per group_size records:
+                     // one disk flush per group, a crash loses at most the last unfinished group
+        none         // like group, but never fdatasync: survives a crash of the process, not of the machine
+    };
+
+    struct durable_options
+    {
+        sync_policy sync = sync_policy::group;
+        size_t group_size = 128;                  // records per group commit
+        size_t checkpoint_log_bytes = 64 << 20;   // start a checkpoint when the log grows beyond, 0: never
+    };
+
+    /*
+     * class durable_treemap<K,T,Compare>
+     * treemap with a write-ahead log in a directory
+     * - insert, insert_or_assign, operator[] (through a proxy) and clear are logged before they
+     *   return; the group policy makes them durable in batches (sync() forces the batch out)
+     * - checkpoint() writes the whole map to a compact file from an O(1) snapshot on a background
+     *   thread, writers go on logging into a fresh log file meanwhile; old logs are deleted after
+     * - the constructor recovers: it loads the checkpoint and replays the newer logs; a torn record
+     *   at the end of a log (crash while writing) is cut off
+     * - values must only be changed through this class, writes through map() are not logged
+     * - I/O errors throw std::system_error
+     * files: checkpoint (header, then records), log.<n> (records)
+     * record: u32 payload length, u32 FNV-1a checksum of the payload, payload (type, key, value)
+     */
+    template <typename K, typename T, typename Compare = std::less<K>>
+    class durable_treemap
+    {
+    public:
+        // public type aliases
+        using key_type = K;
+        using mapped_type = T;
+        using value_type = std::pair<K, T>;
+        using map_type = my::treemap<K, T, Compare>;
+
+        // result of operator[]: reads like T, assigning to it is logged
+        class reference
+        {
+        public:
+            reference &operator=(const T &value)
+            {
+                map_.insert_or_assign(key_, value);
+                return *this;
+            }
+
+            operator const T &() const { return map_.map_.find(key_)->second; }
+
+        private:
+            friend class durable_treemap;
+            reference(durable_treemap &map, const K &key) : map_(map), key_(key) {}
+
+            durable_treemap &map_;
+            K key_;
+        };
+
+        // open (and recover) the map stored in directory, create it if it does not exist
+        explicit durable_treemap(std::string directory, durable_options options = durable_options())
+            : directory_(std::move(directory)), options_(options)
+        {
+            if (::mkdir(directory_.c_str(), 0777) != 0 && errno != EEXIST)
+            {
+                throw_errno_("mkdir " + directory_);
+            }
+            recover_();
+        }
+
+        durable_treemap(const durable_treemap &) = delete;
+        durable_treemap &operator=(const durable_treemap &) = delete;
+
+        // flushes the last group and waits for a running checkpoint
+        ~durable_treemap()
+        {
+            try
+            {
+                sync();
+                wait_checkpoint();
+            }
+            catch (...)
+            {
+                // nothing sensible to do in a destructor, the log up to the last sync is intact
+            }
+            if (checkpoint_thread_.joinable())
+            {
+                checkpoint_thread_.join();
+            }
+            if (log_fd_ >= 0)
+            {
+                ::close(log_fd_);
+            }
+        }
+
+        // number of keys in map
+        size_t size() const { return map_.size(); }
+
+        // how often is the element contained in the map? (0 or 1)
+        size_t count(const K &key) const { return map_.count(key); }
+
+        // read access to the map, e.g. find() - do not write through it
+        const map_type &map() const { return map_; }
+
+        // consistent read-only view for iteration, see treemap::snapshot()
+        typename map_type::snapshot_type snapshot() const { return map_.snapshot(); }
+
+        // random read/write access to value by key, inserts (and logs) T() if key is missing
+        reference operator[](const K &key)
+        {
+            if (map_.count(key) == 0)
+            {
+                insert(key, T());
+            }
+            return reference(*this, key);
+        }
+
+        // insert if key is missing, logged only if it was inserted
+        std::pair<typename map_type::iterator, bool> insert(const K &key, const T &value)
+        {
+            auto result = map_.insert(key, value);
+            if (result.second)
+            {
+                log_put_(key, value);
+            }
+            return result;
+        }
+
+        std::pair<typename map_type::iterator, bool> insert_or_assign(const K &key, const T &value)
+        {
+            auto result = map_.insert_or_assign(key, value);
+            log_put_(key, value);
+            return result;
+        }
+
+        // delete all (key,value) pairs in map
+        void clear()
+        {
+            map_.clear();
+            frame_(pending_, begin_record_(pending_, record_clear));
+            logged_();
+        }
+
+        // write and (unless sync_policy::none) fdatasync the records collected so far
+        void sync()
+        {
+            flush_(options_.sync != sync_policy::none);
+        }
+
+        // write the whole map to the checkpoint file, in the background
+        // waits for a previous checkpoint first; the log is switched to a new file right away
+        void checkpoint()
+        {
+            wait_checkpoint();
+            sync();
+
+            // the checkpoint covers everything before the new log
+            open_log_(log_seq_ + 1);
+            size_t covered_from = log_seq_;
+            checkpoint_thread_ = std::thread(
+                [this, snap = map_.snapshot(), covered_from]()
+                {
+                    try
+                    {
+                        write_checkpoint_(snap, covered_from);
+                    }
+                    catch (...)
+                    {
+                        checkpoint_error_ = std::current_exception();
+                    }
+                });
+        }
+
+        // wait until a running checkpoint is on disk, rethrows its error
+        void wait_checkpoint()
+        {
+            if (checkpoint_thread_.joinable())
+            {
+                checkpoint_thread_.join();
+            }
+            if (checkpoint_error_)
+            {
+                std::exception_ptr error = checkpoint_error_;
+                checkpoint_error_ = nullptr;
+                std::rethrow_exception(error);
+            }
+        }
+
+        // bytes in the current log file (including the records not yet written)
+        size_t log_bytes() const { return log_bytes_ + pending_.size(); }
+
+    private:
+        enum : char
+        {
+            record_put = 1,
+            record_clear = 2
+        };
+
+        std::string directory_;
+        durable_options options_;
+        map_type map_;
+
+        int log_fd_ = -1;
+        size_t log_seq_ = 0;   // number of the current log file
+        size_t log_bytes_ = 0; // bytes written to it
+        std::string pending_;  // records of the current group, not yet written
+        size_t pending_records_ = 0;
+
+        std::thread checkpoint_thread_;
+        std::exception_ptr checkpoint_error_;
+
+        [[noreturn]] static void throw_errno_(const std::string &what)
+        {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        std::string path_(const std::string &name) const { return directory_ + "/" + name; }
+        std::string log_path_(size_t seq) const { return path_("log." + std::to_string(seq)); }
+
+        static uint32_t checksum_(const char *p, size_t size)
+        {
+            uint32_t h = 2166136261u;
+            for (size_t i = 0; i < size; i++)
+            {
+                h = (h ^ uint8_t(p[i])) * 16777619u;
+            }
+            return h;
+        }
+
+        // append room for length and checksum and the record type to out, returns the record's start
+        static size_t begin_record_(std::string &out, char type)
+        {
+            size_t start = out.size();
+            out.append(8, '\0');
+            out += type;
+            return start;
+        }
+
+        // append a put record to out
+        static void put_record_(std::string &out, const K &key, const T &value)
+        {
+            size_t start = begin_record_(out, record_put);
+            durable_codec<K>::write(out, key);
+            durable_codec<T>::write(out, value);
+            frame_(out, start);
+        }
+
+        // fill in length and checksum of the record starting at out[start]
+        static void frame_(std::string &out, size_t start)
+        {
+            uint32_t size = uint32_t(out.size() - start - 8);
+            uint32_t sum = checksum_(out.data() + start + 8, size);
+            std::memcpy(&out[start], &size, 4);
+            std::memcpy(&out[start + 4], &sum, 4);
+        }
+
+        void log_put_(const K &key, const T &value)
+        {
+            put_record_(pending_, key, value);
+            logged_();
+        }
+
+        // a record was added to pending_: group commit and automatic checkpoints
+        void logged_()
+        {
+            pending_records_++;
+            if (options_.sync == sync_policy::every_write || pending_records_ >= options_.group_size)
+            {
+                sync();
+            }
+            if (options_.checkpoint_log_bytes != 0 && log_bytes() > options_.checkpoint_log_bytes &&
+                !checkpoint_thread_.joinable())
+            {
+                checkpoint();
+            }
+        }
+
+        static void write_all_(int fd, const char *p, size_t size, const std::string &what)
+        {
+            while (size > 0)
+            {
+                ssize_t written = ::write(fd, p, size);
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    throw_errno_("write " + what);
+                }
+                p += written;
+                size -= size_t(written);
+            }
+        }
+
+        void flush_(bool to_disk)
+        {
+            if (!pending_.empty())
+            {
+                write_all_(log_fd_, pending_.data(), pending_.size(), log_path_(log_seq_));
+                log_bytes_ += pending_.size();
+                pending_.clear();
+                pending_records_ = 0;
+            }
+            if (to_disk && ::fdatasync(log_fd_) != 0)
+            {
+                throw_errno_("fdatasync " + log_path_(log_seq_));
+            }
+        }
+
+        void open_log_(size_t seq)
+        {
+            int fd = ::open(log_path_(seq).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+            if (fd < 0)
+            {
+                throw_errno_("open " + log_path_(seq));
+            }
+            if (log_fd_ >= 0)
+            {
+                ::close(log_fd_);
+            }
+            log_fd_ = fd;
+            log_seq_ = seq;
+            struct stat st;
+            log_bytes_ = ::fstat(fd, &st) == 0 ? size_t(st.st_size) : 0;
+            sync_directory_();
+        }
+
+        // make created, renamed and deleted files durable
+        void sync_directory_() const
+        {
+            int fd = ::open(directory_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd >= 0)
+            {
+                ::fsync(fd);
+                ::close(fd);
+            }
+        }
+
+        // numbers of all log files, ascending
+        std::vector<size_t> log_files_() const
+        {
+            std::vector<size_t> seqs;
+            DIR *dir = ::opendir(directory_.c_str());
+            if (dir == nullptr)
+            {
+                throw_errno_("opendir " + directory_);
+            }
+            while (dirent *entry = ::readdir(dir))
+            {
+                if (std::strncmp(entry->d_name, "log.", 4) == 0)
+                {
+                    seqs.push_back(std::strtoull(entry->d_name + 4, nullptr, 10));
+                }
+            }
+            ::closedir(dir);
+            std::sort(seqs.begin(), seqs.end());
+            return seqs;
+        }
+
+        // call put(key, value) / clear() for all intact records of a file,
+        // returns the length of the intact part
+        template <typename Put, typename Clear>
+        static size_t read_records_(std::istream &in, Put put, Clear clear)
+        {
+            size_t good = 0;
+            std::string payload;
+            for (;;)
+            {
+                uint32_t header[2];
+                if (!in.read(reinterpret_cast<char *>(header), 8))
+                {
+                    break;
+                }
+                payload.resize(header[0]);
+                if (!in.read(payload.data(), header[0]) || checksum_(payload.data(), payload.size()) != header[1])
+                {
+                    break;
+                }
+                if (payload.empty())
+                {
+                    break;
+                }
+                const char *p = payload.data() + 1;
+                const char *end = payload.data() + payload.size();
+                if (payload[0] == record_clear)
+                {
+                    clear();
+                }
+                else
+                {
+                    K key;
+                    T value;
+                    if (payload[0] != record_put || !durable_codec<K>::read(p, end, key) || !durable_codec<T>::read(p, end, value))
+                    {
+                        break;
+                    }
+                    put(key, value);
+                }
+                good += 8 + header[0];
+            }
+            return good;
+        }
+
+        void recover_()
+        {
+            // checkpoint: "TMCP", number of the first log it does not contain, then records
+            size_t first_log = 0;
+            std::ifstream checkpoint(path_("checkpoint"), std::ios::binary);
+            if (checkpoint)
+            {
+                char magic[4];
+                uint64_t seq;
+                if (checkpoint.read(magic, 4) && std::memcmp(magic, "TMCP", 4) == 0 &&
+                    checkpoint.read(reinterpret_cast<char *>(&seq), 8))
+                {
+                    first_log = size_t(seq);
+
+                    // the records are sorted: inserting them in order would build a list,
+                    // so insert medians first (breadth first over the index ranges)
+                    std::vector<value_type> sorted;
+                    read_records_(
+                        checkpoint, [&](const K &key, const T &value)
+                        { sorted.emplace_back(key, value); },
+                        [] {});
+                    std::vector<std::pair<size_t, size_t>> ranges;
+                    ranges.reserve(sorted.size() + 1);
+                    ranges.emplace_back(0, sorted.size());
+                    for (size_t i = 0; i < ranges.size(); i++)
+                    {
+                        auto [lo, hi] = ranges[i];
+                        if (lo >= hi)
+                        {
+                            continue;
+                        }
+                        size_t mid = lo + (hi - lo) / 2;
+                        map_.insert(sorted[mid].first, sorted[mid].second);
+                        ranges.emplace_back(lo, mid);
+                        ranges.emplace_back(mid + 1, hi);
+                    }
+                }
+            }
+
+            size_t last = first_log;
+            for (size_t seq : log_files_())
+            {
+                if (seq < first_log)
+                {
+                    // already in the checkpoint, left over from a crash before it was deleted
+                    ::unlink(log_path_(seq).c_str());
+                    continue;
+                }
+                std::ifstream log(log_path_(seq), std::ios::binary);
+                size_t good = read_records_(
+                    log, [this](const K &key, const T &value)
+                    { map_.insert_or_assign(key, value); },
+                    [this]
+                    { map_.clear(); });
+                // cut off a torn record, so later appends start at a record boundary
+                if (::truncate(log_path_(seq).c_str(), off_t(good)) != 0)
+                {
+                    throw_errno_("truncate " + log_path_(seq));
+                }
+                last = seq;
+            }
+            open_log_(last);
+        }
+
+        // runs on the checkpoint thread: only touches the snapshot and files no one else writes
+        void write_checkpoint_(const typename map_type::snapshot_type &snap, size_t covered_from)
+        {
+            std::string tmp = path_("checkpoint.tmp");
+            int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+            if (fd < 0)
+            {
+                throw_errno_("open " + tmp);
+            }
+            try
+            {
+                std::string buffer("TMCP");
+                uint64_t seq = covered_from;
+                buffer.append(reinterpret_cast<const char *>(&seq), 8);
+                for (auto it = snap.begin(); it != snap.end(); ++it)
+                {
+                    put_record_(buffer, it->first, it->second);
+                    if (buffer.size() >= (1 << 20))
+                    {
+                        write_all_(fd, buffer.data(), buffer.size(), tmp);
+                        buffer.clear();
+                    }
+                }
+                write_all_(fd, buffer.data(), buffer.size(), tmp);
+                if (::fsync(fd) != 0)
+                {
+                    throw_errno_("fsync " + tmp);
+                }
+            }
+            catch (...)
+            {
+                ::close(fd);
+                throw;
+            }
+            ::close(fd);
+
+            if (::rename(tmp.c_str(), path_("checkpoint").c_str()) != 0)
+            {
+                throw_errno_("rename " + tmp);
+            }
+            sync_directory_();
+
+            for (size_t seq = covered_from; seq-- > 0;)
+            {
+                if (::unlink(log_path_(seq).c_str()) != 0)
+                {
+                    break;
+                }
+            }
+        }
+    };
+
+} // namespace my
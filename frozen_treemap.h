@@ -0,0 +1,239 @@
+// frozen_treemap - read-only map with integer keys (ids, timestamps), compressed
+// keys as bit-packed deltas in blocks, values in a parallel array, built once from a treemap
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace my
+{
+
+    template <typename K, typename T, typename Compare>
+    class treemap;
+
+    /*
+     * class frozen_treemap<K,T>
+     * ordered map with integral keys in ascending order that never changes after construction
+     * - keys are cut into blocks of block_size; each block keeps its first key in a small index
+     *   (binary searched) and the differences between neighbouring keys bit-packed with the
+     *   width its largest difference needs. dense keys (sequence numbers, timestamps at a steady
+     *   rate) need a few bits per key instead of 8 bytes plus a tree node of ~80 bytes
+     * - values are stored as they are, in key order in one array
+     * - a lookup searches the index and decodes one block: a fixed-width unpack, a prefix sum
+     *   and a branch-free rank over the block, loops the compiler can vectorize
+     * - find returns a pointer to the value (nullptr if missing); there are no iterators into
+     *   the keys, for_each decodes them block by block
+     * - built from a treemap<K,T> or any range of (key, value) pairs in strictly ascending key
+     *   order, otherwise std::invalid_argument
+     */
+    template <typename K, typename T>
+    class frozen_treemap
+    {
+        static_assert(std::is_integral_v<K>, "frozen_treemap: keys must be integers");
+
+    public:
+        using key_type = K;
+        using mapped_type = T;
+
+        static constexpr size_t block_size = 64;
+
+        frozen_treemap() = default;
+
+        // (key, value) pairs in strictly ascending key order
+        template <typename It>
+        frozen_treemap(It first, It last)
+        {
+            std::vector<K> keys;
+            for (; first != last; ++first)
+            {
+                if (!keys.empty() && !(keys.back() < first->first))
+                {
+                    throw std::invalid_argument("frozen_treemap: keys not strictly ascending");
+                }
+                keys.push_back(first->first);
+                values_.push_back(first->second);
+            }
+            values_.shrink_to_fit();
+            pack_(keys);
+        }
+
+        template <typename Compare>
+        explicit frozen_treemap(const treemap<K, T, Compare> &source) : frozen_treemap(source.cbegin(), source.cend())
+        {
+        }
+
+        // number of keys in map
+        size_t size() const { return values_.size(); }
+        bool empty() const { return values_.empty(); }
+
+        // memory used for keys, index and values (without memory the values own themselves)
+        size_t bytes() const
+        {
+            return sizeof(*this) + heads_.capacity() * sizeof(K) + offsets_.capacity() * sizeof(uint64_t) +
+                   widths_.capacity() + packed_.capacity() * sizeof(uint64_t) + values_.capacity() * sizeof(T);
+        }
+
+        // value of key, nullptr if it is missing
+        const T *find(K key) const
+        {
+            size_t b = block_of_(key);
+            if (b == npos)
+            {
+                return nullptr;
+            }
+            K keys[block_size];
+            size_t length = decode_(b, keys);
+            // number of keys less than key, without a branch on the comparisons
+            size_t rank = 0;
+            for (size_t i = 0; i < length; i++)
+            {
+                rank += keys[i] < key;
+            }
+            return rank < length && keys[rank] == key ? &values_[b * block_size + rank] : nullptr;
+        }
+
+        // how often is the element contained in the map? (0 or 1)
+        size_t count(K key) const { return find(key) != nullptr ? 1 : 0; }
+
+        // value of key, std::out_of_range if it is missing
+        const T &at(K key) const
+        {
+            const T *value = find(key);
+            if (value == nullptr)
+            {
+                throw std::out_of_range("frozen_treemap: key not found");
+            }
+            return *value;
+        }
+
+        // f(key, value) for every element in key order
+        template <typename F>
+        void for_each(F f) const
+        {
+            K keys[block_size];
+            for (size_t b = 0; b < heads_.size(); b++)
+            {
+                size_t length = decode_(b, keys);
+                for (size_t i = 0; i < length; i++)
+                {
+                    f(keys[i], values_[b * block_size + i]);
+                }
+            }
+        }
+
+        // f(key, value) for the keys in [first, last) in key order
+        template <typename F>
+        void for_each(K first, K last, F f) const
+        {
+            if (empty() || !(first < last))
+            {
+                return;
+            }
+            size_t b = block_of_(first);
+            K keys[block_size];
+            for (b = b == npos ? 0 : b; b < heads_.size() && heads_[b] < last; b++)
+            {
+                size_t length = decode_(b, keys);
+                for (size_t i = 0; i < length && keys[i] < last; i++)
+                {
+                    if (!(keys[i] < first))
+                    {
+                        f(keys[i], values_[b * block_size + i]);
+                    }
+                }
+            }
+        }
+
+    protected:
+        using U = std::make_unsigned_t<K>;
+        static constexpr size_t npos = size_t(-1);
+
+        std::vector<K> heads_;          // first key of every block
+        std::vector<uint64_t> offsets_; // bit position of every block's deltas in packed_
+        std::vector<uint8_t> widths_;   // bits per delta in every block
+        std::vector<uint64_t> packed_;  // one word more than needed, so reads never check the end
+        std::vector<T> values_;
+
+        // differences are taken modulo 2^bits, so signed keys need no special case
+        void pack_(const std::vector<K> &keys)
+        {
+            size_t blocks = (keys.size() + block_size - 1) / block_size;
+            heads_.reserve(blocks);
+            offsets_.reserve(blocks);
+            widths_.reserve(blocks);
+            uint64_t bit = 0;
+            for (size_t b = 0; b < blocks; b++)
+            {
+                size_t from = b * block_size, to = std::min(keys.size(), from + block_size);
+                U widest = 0;
+                for (size_t i = from + 1; i < to; i++)
+                {
+                    widest = std::max<U>(widest, U(U(keys[i]) - U(keys[i - 1])));
+                }
+                heads_.push_back(keys[from]);
+                offsets_.push_back(bit);
+                widths_.push_back(uint8_t(std::bit_width(widest)));
+                bit += uint64_t(widths_.back()) * (to - from - 1);
+            }
+            packed_.assign(size_t(bit / 64 + 2), 0);
+            for (size_t b = 0; b < blocks; b++)
+            {
+                size_t from = b * block_size, to = std::min(keys.size(), from + block_size);
+                unsigned width = widths_[b];
+                bit = offsets_[b];
+                for (size_t i = from + 1; i < to; i++, bit += width)
+                {
+                    uint64_t delta = uint64_t(U(U(keys[i]) - U(keys[i - 1])));
+                    unsigned shift = unsigned(bit % 64);
+                    packed_[bit / 64] |= delta << shift;
+                    if (shift + width > 64)
+                    {
+                        packed_[bit / 64 + 1] |= delta >> (64 - shift);
+                    }
+                }
+            }
+        }
+
+        // block whose range can contain key, npos if key is below the first key
+        size_t block_of_(K key) const
+        {
+            auto it = std::upper_bound(heads_.begin(), heads_.end(), key);
+            return it == heads_.begin() ? npos : size_t(it - heads_.begin()) - 1;
+        }
+
+        // keys of block b, returns how many
+        size_t decode_(size_t b, K *keys) const
+        {
+            size_t length = std::min(block_size, values_.size() - b * block_size);
+            unsigned width = widths_[b];
+            uint64_t mask = width == 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1;
+            uint64_t bit = offsets_[b];
+            // unpack: every delta from the two words it may span
+            uint64_t deltas[block_size];
+            for (size_t i = 1; i < length; i++, bit += width)
+            {
+                const uint64_t *word = &packed_[bit / 64];
+                unsigned shift = unsigned(bit % 64);
+                // (x << 1) << (63 - shift) is x << (64 - shift), but defined for shift == 0
+                deltas[i] = ((word[0] >> shift) | ((word[1] << 1) << (63 - shift))) & mask;
+            }
+            U current = U(heads_[b]);
+            keys[0] = heads_[b];
+            for (size_t i = 1; i < length; i++)
+            {
+                current = U(current + U(deltas[i]));
+                keys[i] = K(current);
+            }
+            return length;
+        }
+    };
+
+} // namespace my
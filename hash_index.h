@@ -0,0 +1,152 @@
+// node_hash_index - open-addressing hash table from key hash to tree node
+// used by treemap to answer exact-key lookups without descending the tree
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace my
+{
+
+    /*
+     * class node_hash_index<Node>
+     * hash index over the nodes of a tree: the keys stay in the nodes, the table only holds
+     * (hash, node address) pairs - 16 bytes per slot
+     * - linear probing in a power-of-two table, at most 3/4 full (doubled when it would be fuller)
+     * - the stored hash is compared first, so probing rarely touches a node that does not match
+     * - erase shifts the following entries back instead of leaving tombstones
+     * - hashes of any quality, they are remixed (Fibonacci hashing) to pick the home slot
+     */
+    template <typename Node>
+    class node_hash_index
+    {
+    public:
+        // table sized for expected_keys without growing
+        explicit node_hash_index(size_t expected_keys = 0)
+        {
+            resize_(std::bit_ceil(std::max<size_t>(16, expected_keys + expected_keys / 3 + 1)));
+        }
+
+        // the node with this hash for which match(node) is true, nullptr if none
+        template <typename Match>
+        Node *find(size_t hash, Match match) const
+        {
+            for (size_t i = home_(hash);; i = (i + 1) & mask_)
+            {
+                const slot &s = slots_[i];
+                if (s.node_ == nullptr)
+                {
+                    return nullptr;
+                }
+                if (s.hash_ == hash && match(s.node_))
+                {
+                    return s.node_;
+                }
+            }
+        }
+
+        // add a node whose key is not in the index yet
+        void insert(size_t hash, Node *n)
+        {
+            if (4 * (count_ + 1) > 3 * slots_.size())
+            {
+                grow_();
+            }
+            place_(hash, n);
+            count_++;
+        }
+
+        // the node was copied (copy-on-write): point its entry at the copy
+        void replace(size_t hash, const Node *old_node, Node *new_node)
+        {
+            slots_[position_(hash, old_node)].node_ = new_node;
+        }
+
+        // remove the entry of a node that is in the index
+        void erase(size_t hash, const Node *n)
+        {
+            size_t hole = position_(hash, n);
+            // backward shift: move up every following entry whose home slot is not between hole and it
+            for (size_t i = (hole + 1) & mask_; slots_[i].node_ != nullptr; i = (i + 1) & mask_)
+            {
+                size_t home = home_(slots_[i].hash_);
+                if (((i - home) & mask_) >= ((i - hole) & mask_))
+                {
+                    slots_[hole] = slots_[i];
+                    hole = i;
+                }
+            }
+            slots_[hole] = slot();
+            count_--;
+        }
+
+        void clear()
+        {
+            std::fill(slots_.begin(), slots_.end(), slot());
+            count_ = 0;
+        }
+
+        size_t size() const { return count_; }
+        size_t bytes() const { return slots_.capacity() * sizeof(slot); }
+
+    protected:
+        struct slot
+        {
+            size_t hash_ = 0;
+            Node *node_ = nullptr; // nullptr: empty
+        };
+
+        std::vector<slot> slots_;
+        size_t mask_ = 0;
+        unsigned shift_ = 0;
+        size_t count_ = 0;
+
+        size_t home_(size_t hash) const { return size_t((uint64_t(hash) * 0x9E3779B97F4A7C15ull) >> shift_); }
+
+        size_t position_(size_t hash, const Node *n) const
+        {
+            size_t i = home_(hash);
+            while (slots_[i].node_ != n)
+            {
+                i = (i + 1) & mask_;
+            }
+            return i;
+        }
+
+        void place_(size_t hash, Node *n)
+        {
+            size_t i = home_(hash);
+            while (slots_[i].node_ != nullptr)
+            {
+                i = (i + 1) & mask_;
+            }
+            slots_[i] = slot{hash, n};
+        }
+
+        void resize_(size_t size)
+        {
+            slots_.assign(size, slot());
+            mask_ = size - 1;
+            shift_ = unsigned(64 - std::countr_zero(size));
+        }
+
+        void grow_()
+        {
+            std::vector<slot> old;
+            old.swap(slots_);
+            resize_(2 * old.size());
+            for (const slot &s : old)
+            {
+                if (s.node_ != nullptr)
+                {
+                    place_(s.hash_, s.node_);
+                }
+            }
+        }
+    };
+
+} // namespace my
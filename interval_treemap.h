@@ -0,0 +1,506 @@
+// interval_treemap - ordered map from intervals to values, with overlap and stabbing queries
+// every node also knows the largest end point in its subtree (an augmented binary search tree)
+
+#pragma once
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace my
+{
+
+    // half-open interval [start, end), e.g. a time window
+    template <typename P>
+    struct interval
+    {
+        P start;
+        P end;
+
+        bool operator==(const interval &) const = default;
+    };
+
+    /*
+     * class interval_treemap<P,T,Compare>
+     * map from intervals [start, end) to values, ordered by start (then end); equal intervals
+     * are one key, like in treemap
+     * - every node keeps max_end_, the largest end point in its subtree, so queries skip every
+     *   subtree that ends before the query begins: overlapping(a, b) and containing(t) report
+     *   k intervals in start order in O(min(n, (k + 1) log n)). when the hits are a run in start
+     *   order (e.g. windows of similar length) that is O(log n + k); long intervals among many
+     *   short ones that start earlier cost one descent each
+     * - scapegoat rebuilding is always on (alpha 0.7 by default): time windows mostly arrive in
+     *   order, which would otherwise make the tree a list; rebuilding keeps the depth at
+     *   O(log n) after inserts and erases
+     * - insert_sorted() loads an ascending stream into an empty map as a balanced tree in O(n)
+     * - an interval with end <= start contains nothing and overlaps nothing, but can be stored
+     */
+    template <typename P, typename T, typename Compare = std::less<P>>
+    class interval_treemap
+    {
+    public:
+        // public type aliases
+        using interval_type = interval<P>;
+        using key_type = interval_type;
+        using mapped_type = T;
+        using point_compare = Compare;
+
+        explicit interval_treemap(double alpha = 0.7, const Compare &comp = Compare())
+            : alpha_(alpha), comp_(comp)
+        {
+            if (!(alpha > 0.5 && alpha < 1.0))
+            {
+                throw std::invalid_argument("interval_treemap: alpha must be in (0.5, 1)");
+            }
+        }
+
+        interval_treemap(const interval_treemap &) = delete;
+        interval_treemap &operator=(const interval_treemap &) = delete;
+        ~interval_treemap() { clear(); }
+
+        // number of intervals in map
+        size_t size() const { return count_; }
+        bool empty() const { return count_ == 0; }
+
+        // levels of the tree, 0 if empty
+        size_t height() const { return height_(root_.get()); }
+
+        void clear()
+        {
+            destroy_(std::move(root_));
+            count_ = 0;
+            max_count_ = 0;
+        }
+
+        // value of this exact interval, nullptr if not contained
+        T *find(const interval_type &key) const
+        {
+            node *n = root_.get();
+            while (n != nullptr)
+            {
+                if (less_(key, n->key_))
+                {
+                    n = n->left_.get();
+                }
+                else if (less_(n->key_, key))
+                {
+                    n = n->right_.get();
+                }
+                else
+                {
+                    return &n->value_;
+                }
+            }
+            return nullptr;
+        }
+
+        // how often is the interval contained in the map? (0 or 1)
+        size_t count(const interval_type &key) const { return find(key) != nullptr ? 1 : 0; }
+
+        // random read/write access to value by interval, inserts T() if missing
+        T &operator[](const interval_type &key) { return insert_(key, T(), false).first->value_; }
+
+        // insert if the interval is missing, returns whether it was inserted
+        bool insert(const interval_type &key, const T &value) { return insert_(key, value, false).second; }
+
+        bool insert_or_assign(const interval_type &key, const T &value) { return insert_(key, value, true).second; }
+
+        // remove this exact interval, returns the number of removed elements (0 or 1)
+        size_t erase(const interval_type &key);
+
+        // f(interval, value) for every interval that overlaps [start, end), in start order
+        template <typename F>
+        void overlapping(const P &start, const P &end, F f) const
+        {
+            if (comp_(start, end))
+            {
+                query_(root_.get(), start, [&](const P &s)
+                       { return comp_(s, end); }, f);
+            }
+        }
+
+        // f(interval, value) for every interval that contains the point t (stabbing query)
+        template <typename F>
+        void containing(const P &t, F f) const
+        {
+            query_(root_.get(), t, [&](const P &s)
+                   { return !comp_(t, s); }, f);
+        }
+
+        size_t count_overlapping(const P &start, const P &end) const
+        {
+            size_t k = 0;
+            overlapping(start, end, [&](const interval_type &, const T &)
+                        { k++; });
+            return k;
+        }
+
+        size_t count_containing(const P &t) const
+        {
+            size_t k = 0;
+            containing(t, [&](const interval_type &, const T &)
+                       { k++; });
+            return k;
+        }
+
+        // f(interval, value) for all elements, in start order
+        template <typename F>
+        void for_each(F f) const
+        {
+            std::vector<node *> stack;
+            node *current = root_.get();
+            while (current != nullptr || !stack.empty())
+            {
+                while (current != nullptr)
+                {
+                    stack.push_back(current);
+                    current = current->left_.get();
+                }
+                current = stack.back();
+                stack.pop_back();
+                f(const_cast<const interval_type &>(current->key_), current->value_);
+                current = current->right_.get();
+            }
+        }
+
+        // bulk load of (interval, value) pairs in strictly ascending order (start, then end):
+        // into an empty map the tree is built balanced in one pass, otherwise it is one insert
+        // per element. unsorted input throws std::invalid_argument before anything is inserted
+        // returns the number of inserted elements
+        template <typename It>
+        size_t insert_sorted(It first, It last);
+
+    protected:
+        struct node
+        {
+            interval_type key_;
+            T value_;
+            P max_end_; // largest end in this subtree
+            node *up_ = nullptr;
+            std::unique_ptr<node> left_, right_;
+
+            node(const interval_type &key, const T &value, node *up)
+                : key_(key), value_(value), max_end_(key.end), up_(up)
+            {
+            }
+        };
+        using node_ptr = std::unique_ptr<node>;
+
+        node_ptr root_;
+        size_t count_ = 0;
+        size_t max_count_ = 0; // largest count_ since the last rebuild of the whole tree
+        double alpha_;
+        [[no_unique_address]] Compare comp_;
+
+        bool less_(const interval_type &a, const interval_type &b) const
+        {
+            return comp_(a.start, b.start) || (!comp_(b.start, a.start) && comp_(a.end, b.end));
+        }
+
+        const P &max_(const P &a, const P &b) const { return comp_(a, b) ? b : a; }
+
+        // max_end_ from the node's own end and its children
+        void update_(node *n) const
+        {
+            n->max_end_ = n->key_.end;
+            if (n->left_)
+            {
+                n->max_end_ = max_(n->max_end_, n->left_->max_end_);
+            }
+            if (n->right_)
+            {
+                n->max_end_ = max_(n->max_end_, n->right_->max_end_);
+            }
+        }
+
+        node_ptr &slot_(node *n) { return n->up_ == nullptr ? root_ : (n->up_->left_.get() == n ? n->up_->left_ : n->up_->right_); }
+
+        // intervals that end after from and whose start passes starts_in
+        // a subtree whose max_end_ is not after from is skipped; right of a start that does not
+        // pass, nothing passes (keys are ordered by start)
+        template <typename StartsIn, typename F>
+        void query_(node *n, const P &from, StartsIn starts_in, F &f) const
+        {
+            while (n != nullptr && comp_(from, n->max_end_))
+            {
+                query_(n->left_.get(), from, starts_in, f);
+                if (!starts_in(n->key_.start))
+                {
+                    return;
+                }
+                // empty and inverted intervals (end <= start) overlap nothing
+                if (comp_(from, n->key_.end) && comp_(n->key_.start, n->key_.end))
+                {
+                    f(const_cast<const interval_type &>(n->key_), n->value_);
+                }
+                n = n->right_.get();
+            }
+        }
+
+        std::pair<node *, bool> insert_(const interval_type &key, const T &value, bool assign);
+
+        // rebuild the subtree of n perfectly balanced, returns its new root
+        node *rebuild_(node *n);
+        static node_ptr build_balanced_(std::vector<node_ptr> &sorted, size_t first, size_t last, node *up, const interval_treemap &map);
+
+        static size_t height_(const node *n)
+        {
+            return n == nullptr ? 0 : 1 + std::max(height_(n->left_.get()), height_(n->right_.get()));
+        }
+
+        static size_t subtree_size_(const node *n)
+        {
+            return n == nullptr ? 0 : 1 + subtree_size_(n->left_.get()) + subtree_size_(n->right_.get());
+        }
+
+        // iterative, a long list would overflow the stack of the recursive destructor
+        static void destroy_(node_ptr n)
+        {
+            std::vector<node_ptr> stack;
+            if (n)
+            {
+                stack.push_back(std::move(n));
+            }
+            while (!stack.empty())
+            {
+                node_ptr m = std::move(stack.back());
+                stack.pop_back();
+                if (m->left_)
+                {
+                    stack.push_back(std::move(m->left_));
+                }
+                if (m->right_)
+                {
+                    stack.push_back(std::move(m->right_));
+                }
+            }
+        }
+    };
+
+    template <typename P, typename T, typename Compare>
+    std::pair<typename interval_treemap<P, T, Compare>::node *, bool>
+    interval_treemap<P, T, Compare>::insert_(const interval_type &key, const T &value, bool assign)
+    {
+        node *up = nullptr;
+        node_ptr *slot = &root_;
+        size_t depth = 0;
+        while (*slot)
+        {
+            node *n = slot->get();
+            if (less_(key, n->key_))
+            {
+                slot = &n->left_;
+            }
+            else if (less_(n->key_, key))
+            {
+                slot = &n->right_;
+            }
+            else
+            {
+                if (assign)
+                {
+                    n->value_ = value;
+                }
+                return {n, false};
+            }
+            up = n;
+            depth++;
+        }
+        *slot = std::make_unique<node>(key, value, up);
+        node *inserted = slot->get();
+        count_++;
+        max_count_ = std::max(max_count_, count_);
+
+        // the new end can only raise max_end_ on the path
+        for (node *n = up; n != nullptr && comp_(n->max_end_, key.end); n = n->up_)
+        {
+            n->max_end_ = key.end;
+        }
+
+        // too deep: rebuild below the lowest ancestor whose child holds more than alpha of it
+        // (the bound is at least log2(count_), skip the logarithms for shallow nodes)
+        if (depth >= size_t(std::bit_width(count_)) &&
+            double(depth) > std::log(double(count_)) / std::log(1.0 / alpha_))
+        {
+            node *child = inserted;
+            size_t child_size = 1;
+            for (node *parent = up; parent != nullptr; parent = parent->up_)
+            {
+                node *sibling = parent->left_.get() == child ? parent->right_.get() : parent->left_.get();
+                size_t parent_size = child_size + 1 + subtree_size_(sibling);
+                if (double(child_size) > alpha_ * double(parent_size))
+                {
+                    rebuild_(parent);
+                    break;
+                }
+                child = parent;
+                child_size = parent_size;
+            }
+        }
+        return {inserted, true};
+    }
+
+    template <typename P, typename T, typename Compare>
+    size_t interval_treemap<P, T, Compare>::erase(const interval_type &key)
+    {
+        node *n = root_.get();
+        while (n != nullptr && (less_(key, n->key_) || less_(n->key_, key)))
+        {
+            n = less_(key, n->key_) ? n->left_.get() : n->right_.get();
+        }
+        if (n == nullptr)
+        {
+            return 0;
+        }
+
+        // lowest node whose subtree changed, max_end_ is fixed from there up
+        node *changed;
+        node_ptr &slot = slot_(n);
+        node_ptr removed = std::move(slot);
+        if (!n->left_ || !n->right_)
+        {
+            // at most one child: it takes n's place
+            node_ptr child = std::move(n->left_ ? n->left_ : n->right_);
+            if (child)
+            {
+                child->up_ = n->up_;
+            }
+            slot = std::move(child);
+            changed = n->up_;
+        }
+        else
+        {
+            // two children: the leftmost node of the right subtree takes n's place
+            node *s = n->right_.get();
+            while (s->left_)
+            {
+                s = s->left_.get();
+            }
+            node_ptr successor;
+            if (s->up_ == n)
+            {
+                successor = std::move(n->right_);
+                changed = s;
+            }
+            else
+            {
+                node *successor_parent = s->up_;
+                successor = std::move(successor_parent->left_);
+                successor_parent->left_ = std::move(s->right_);
+                if (successor_parent->left_)
+                {
+                    successor_parent->left_->up_ = successor_parent;
+                }
+                s->right_ = std::move(n->right_);
+                s->right_->up_ = s;
+                changed = successor_parent;
+            }
+            s->left_ = std::move(n->left_);
+            s->left_->up_ = s;
+            s->up_ = n->up_;
+            slot = std::move(successor);
+        }
+        for (; changed != nullptr; changed = changed->up_)
+        {
+            update_(changed);
+        }
+        count_--;
+
+        // many erases since the last full rebuild: the tree may have become too deep
+        if (double(count_) < alpha_ * double(max_count_) && root_)
+        {
+            rebuild_(root_.get());
+            max_count_ = count_;
+        }
+        return 1;
+    }
+
+    template <typename P, typename T, typename Compare>
+    template <typename It>
+    size_t interval_treemap<P, T, Compare>::insert_sorted(It first, It last)
+    {
+        // check the order first, so bad input leaves the map unchanged
+        size_t n = 0;
+        const interval_type *previous = nullptr;
+        for (It it = first; it != last; ++it, n++)
+        {
+            const interval_type &key = it->first;
+            if (previous != nullptr && !less_(*previous, key))
+            {
+                throw std::invalid_argument("interval_treemap::insert_sorted: intervals not in ascending order");
+            }
+            previous = &key;
+        }
+
+        if (!root_)
+        {
+            std::vector<node_ptr> sorted;
+            sorted.reserve(n);
+            for (It it = first; it != last; ++it)
+            {
+                sorted.push_back(std::make_unique<node>(it->first, it->second, nullptr));
+            }
+            root_ = build_balanced_(sorted, 0, sorted.size(), nullptr, *this);
+            count_ = max_count_ = n;
+            return n;
+        }
+        size_t inserted = 0;
+        for (It it = first; it != last; ++it)
+        {
+            inserted += insert_(it->first, it->second, false).second ? 1 : 0;
+        }
+        return inserted;
+    }
+
+    template <typename P, typename T, typename Compare>
+    typename interval_treemap<P, T, Compare>::node *interval_treemap<P, T, Compare>::rebuild_(node *n)
+    {
+        node *up = n->up_;
+        node_ptr &slot = slot_(n);
+
+        // collect the subtree in order (iteratively, it may be a long list), the vector owns the nodes
+        std::vector<node_ptr> sorted;
+        std::vector<node_ptr> stack;
+        node_ptr current = std::move(slot);
+        while (current || !stack.empty())
+        {
+            while (current)
+            {
+                node_ptr left = std::move(current->left_);
+                stack.push_back(std::move(current));
+                current = std::move(left);
+            }
+            sorted.push_back(std::move(stack.back()));
+            stack.pop_back();
+            current = std::move(sorted.back()->right_);
+        }
+
+        slot = build_balanced_(sorted, 0, sorted.size(), up, *this);
+        return slot.get();
+    }
+
+    template <typename P, typename T, typename Compare>
+    typename interval_treemap<P, T, Compare>::node_ptr
+    interval_treemap<P, T, Compare>::build_balanced_(std::vector<node_ptr> &sorted, size_t first, size_t last, node *up,
+                                                    const interval_treemap &map)
+    {
+        // recursion depth is log2 of the subtree size, the result is balanced
+        if (first == last)
+        {
+            return nullptr;
+        }
+        size_t middle = first + (last - first) / 2;
+        node_ptr m = std::move(sorted[middle]);
+        m->up_ = up;
+        m->left_ = build_balanced_(sorted, first, middle, m.get(), map);
+        m->right_ = build_balanced_(sorted, middle + 1, last, m.get(), map);
+        map.update_(m.get());
+        return m;
+    }
+
+} // namespace my
@@ -0,0 +1,247 @@
+// node_memory - where the nodes of very large maps live: huge pages, NUMA nodes, per-socket replicas
+// huge_page_resource (a std::pmr::memory_resource for treemap::node_resource), NUMA helpers and
+// numa_replicas (read-mostly copies of a map, one per NUMA node)
+// Linux only; without NUMA or transparent huge pages everything still works, just without them
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "treemap.h"
+
+namespace my
+{
+
+    // NUMA nodes of this machine (1 if unknown)
+    inline unsigned numa_node_count()
+    {
+        // e.g. "0-1" or "0"; the highest node number + 1
+        std::ifstream online("/sys/devices/system/node/online");
+        std::string ranges;
+        if (!(online >> ranges))
+        {
+            return 1;
+        }
+        size_t last = ranges.find_last_of(",-");
+        return unsigned(std::stoul(last == std::string::npos ? ranges : ranges.substr(last + 1))) + 1;
+    }
+
+    // NUMA node of the CPU the calling thread runs on right now (0 if unknown)
+    inline unsigned current_numa_node()
+    {
+        unsigned cpu = 0, node = 0;
+        if (::syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        {
+            return 0;
+        }
+        return node;
+    }
+
+    struct huge_page_options
+    {
+        size_t chunk_bytes = size_t(64) << 20; // memory is mapped in chunks of this size (rounded to 2 MB)
+        bool huge_pages = true;                // madvise(MADV_HUGEPAGE) for every chunk
+        int numa_node = -1;                    // prefer this node's memory (mbind), -1: no preference
+    };
+
+    /*
+     * class huge_page_resource
+     * memory resource for tree nodes: large 2 MB-aligned chunks, so transparent huge pages can
+     * back them, optionally placed on one NUMA node
+     * - a node lookup then needs one TLB entry per 2 MB instead of per 4 KB: with 100M nodes
+     *   spread over GBs, most hops otherwise miss the TLB as well as the cache
+     * - small blocks (up to 4 KB) are carved from the chunks and recycled through free lists per
+     *   16-byte size class, larger ones go to the upstream resource
+     * - memory goes back to the system only when the resource is destroyed; maps, copies and
+     *   snapshots using it must be gone by then
+     * - thread-safe (a mutex), so a parallel build can share it
+     * - huge pages need /sys/kernel/mm/transparent_hugepage/enabled at "madvise" or "always";
+     *   NUMA placement uses mbind with MPOL_PREFERRED, so it never fails an allocation
+     */
+    class huge_page_resource : public std::pmr::memory_resource
+    {
+    public:
+        static constexpr size_t huge_page = size_t(2) << 20;
+        static constexpr size_t max_small = 4096;
+
+        explicit huge_page_resource(const huge_page_options &options = huge_page_options(),
+                                    std::pmr::memory_resource *upstream = std::pmr::new_delete_resource())
+            : options_(options), upstream_(upstream)
+        {
+            options_.chunk_bytes = std::max(huge_page, (options_.chunk_bytes + huge_page - 1) / huge_page * huge_page);
+        }
+
+        huge_page_resource(const huge_page_resource &) = delete;
+        huge_page_resource &operator=(const huge_page_resource &) = delete;
+
+        ~huge_page_resource() override
+        {
+            for (auto &c : chunks_)
+            {
+                ::munmap(c.first, c.second);
+            }
+        }
+
+        const huge_page_options &options() const { return options_; }
+
+        // bytes mapped for chunks
+        size_t mapped_bytes() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return mapped_;
+        }
+
+    protected:
+        huge_page_options options_;
+        std::pmr::memory_resource *upstream_;
+        mutable std::mutex mutex_;
+        std::vector<std::pair<void *, size_t>> chunks_;
+        char *cursor_ = nullptr; // free part of the newest chunk
+        char *limit_ = nullptr;
+        size_t mapped_ = 0;
+        void *free_[max_small / 16 + 1] = {}; // per size class, linked through the blocks
+
+        void *do_allocate(size_t bytes, size_t alignment) override
+        {
+            if (bytes > max_small || alignment > 16)
+            {
+                return upstream_->allocate(bytes, alignment);
+            }
+            size_t size_class = (std::max<size_t>(bytes, 1) + 15) / 16;
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (void *block = free_[size_class])
+            {
+                free_[size_class] = *static_cast<void **>(block);
+                return block;
+            }
+            size_t size = size_class * 16;
+            if (size_t(limit_ - cursor_) < size)
+            {
+                map_chunk_();
+            }
+            void *block = cursor_;
+            cursor_ += size;
+            return block;
+        }
+
+        void do_deallocate(void *block, size_t bytes, size_t alignment) override
+        {
+            if (bytes > max_small || alignment > 16)
+            {
+                upstream_->deallocate(block, bytes, alignment);
+                return;
+            }
+            size_t size_class = (std::max<size_t>(bytes, 1) + 15) / 16;
+            std::lock_guard<std::mutex> lock(mutex_);
+            *static_cast<void **>(block) = free_[size_class];
+            free_[size_class] = block;
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+        // a new chunk, aligned to 2 MB (mapped one huge page larger, then trimmed)
+        void map_chunk_()
+        {
+            size_t size = options_.chunk_bytes;
+            void *p = ::mmap(nullptr, size + huge_page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+            {
+                throw std::bad_alloc();
+            }
+            uintptr_t start = (uintptr_t(p) + huge_page - 1) & ~uintptr_t(huge_page - 1);
+            size_t head = start - uintptr_t(p);
+            if (head > 0)
+            {
+                ::munmap(p, head);
+            }
+            ::munmap(reinterpret_cast<void *>(start + size), huge_page - head);
+            char *chunk = reinterpret_cast<char *>(start);
+
+            if (options_.huge_pages)
+            {
+                ::madvise(chunk, size, MADV_HUGEPAGE);
+            }
+            if (options_.numa_node >= 0 && options_.numa_node < 63)
+            {
+                // before the first touch, so the pages are faulted in on that node
+                const int mpol_preferred = 1;
+                unsigned long mask = 1ul << options_.numa_node;
+                ::syscall(SYS_mbind, chunk, size, mpol_preferred, &mask, 64ul, 0u);
+            }
+            chunks_.emplace_back(chunk, size);
+            cursor_ = chunk;
+            limit_ = chunk + size;
+            mapped_ += size;
+        }
+    };
+
+    /*
+     * class numa_replicas<K,T,Compare>
+     * one copy of a read-mostly map per NUMA node, each in memory of its node
+     * (huge_page_resource with numa_node set), so lookups never cross the socket interconnect
+     * - local() is the replica of the NUMA node the calling thread runs on; pin reader threads
+     *   to a socket for it to stay local
+     * - update(f) applies f(treemap &) to every replica; writes are not synchronized with
+     *   lookups: update between read phases (or build new replicas and swap them in)
+     * - memory is the map's size times the number of NUMA nodes
+     */
+    template <typename K, typename T, typename Compare = std::less<K>>
+    class numa_replicas
+    {
+    public:
+        using map_type = treemap<K, T, Compare>;
+
+        // replicas of source on every NUMA node (nodes = 0: all of them)
+        explicit numa_replicas(const map_type &source, unsigned nodes = 0, bool huge_pages = true)
+        {
+            nodes = nodes != 0 ? nodes : numa_node_count();
+            for (unsigned node = 0; node < nodes; node++)
+            {
+                huge_page_options options;
+                options.huge_pages = huge_pages;
+                options.numa_node = nodes > 1 ? int(node) : -1;
+                resources_.push_back(std::make_unique<huge_page_resource>(options));
+                replicas_.push_back(std::make_unique<map_type>(source.key_comp()));
+                replicas_.back()->node_resource(resources_.back().get());
+            }
+            // balanced copies, their nodes in the memory of their node
+            update([&](map_type &replica)
+                   { replica.insert_or_assign_sorted(source.cbegin(), source.cend()); });
+        }
+
+        size_t replica_count() const { return replicas_.size(); }
+
+        const map_type &local() const { return *replicas_[current_numa_node() % replicas_.size()]; }
+        const map_type &replica(unsigned node) const { return *replicas_[node]; }
+
+        // f(replica) for every replica; new nodes go to the replica's node
+        template <typename F>
+        void update(F f)
+        {
+            for (auto &replica : replicas_)
+            {
+                f(*replica);
+            }
+        }
+
+    protected:
+        // declared first, destroyed last: the maps live in this memory
+        std::vector<std::unique_ptr<huge_page_resource>> resources_;
+        std::vector<std::unique_ptr<map_type>> replicas_;
+    };
+
+} // namespace my
@@ -3,6 +3,10 @@
 // define the payload's static counts
 size_t Payload::ctor_count_ = 0;
 size_t Payload::dtor_count_ = 0;
+size_t Payload::copy_ctor_count_ = 0;
+size_t Payload::move_ctor_count_ = 0;
+size_t Payload::copy_assign_count_ = 0;
+size_t Payload::move_assign_count_ = 0;
 
 // switch console logging on/off
 bool Payload::do_logging_ = false;
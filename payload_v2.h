@@ -21,6 +21,8 @@ inline std::ostream& operator<<(std::ostream& os, const Payload& p);
  *  - checks if you access Payload object before construction (if ID is in wrong range)
  *  - marks memory of destructed Payload object with a special ID
  *  - checks if you access Payload object after destruction
+ *  - counts copies and moves (constructions and assignments) separately, so tests
+ *    can assert that a container does not copy where it could move
  *
  */
 class Payload {
@@ -32,6 +34,12 @@ class Payload {
     static size_t ctor_count_;
     static size_t dtor_count_;
 
+    // the total number of copies and moves, constructions and assignments
+    static size_t copy_ctor_count_;
+    static size_t move_ctor_count_;
+    static size_t copy_assign_count_;
+    static size_t move_assign_count_;
+
     // is console logging currently switched on?
     static bool do_logging_; 
 
@@ -64,15 +72,18 @@ public:
         if(do_logging_) std::cout << "Payload-copy-ctor(" << id_ << "|" << content << ")" << std::endl;
 
         ctor_count_++; // one more Payload has been created
+        copy_ctor_count_++;
     }
 
-    Payload(const Payload&& rhs) 
-        : id_(ctor_count_ + start_id_), content(rhs.content)
+    // takes over the content, rhs is left with an empty content
+    Payload(Payload&& rhs) noexcept
+        : id_(ctor_count_ + start_id_), content(std::move(rhs.content))
     {
         if(do_logging_) 
             std::cout << "Payload-move-ctor(" << id_ << "|" << content << ")" << std::endl;
 
         ctor_count_++; // one more Payload has been created
+        move_ctor_count_++;
     }
 
     // destructor
@@ -96,18 +107,20 @@ public:
 
         check_(); // detect if this Payload object was properly initialized etc.
         content = rhs.content; // copy user content
+        copy_assign_count_++;
         // alive count stays the same, no object is constructed or destroyed
         return *this;
     }
  
     // move assignment 
-    Payload& operator=(Payload&& rhs) 
+    Payload& operator=(Payload&& rhs) noexcept
     {
         if(do_logging_) 
             std::cout << "Payload-move-assign(" << id_ << "|" << content << ")" << std::endl;
 
         check_(); // was the object initialized properly?
-        content = rhs.content; // copy user content, should use move() here?
+        content = std::move(rhs.content); // take over user content
+        move_assign_count_++;
         // alive count stays the same, no object is constructed or destroyed
         return *this;
     }
@@ -138,6 +151,12 @@ public:
     // how many instances of Payload have been constructed over the lifetime of this process?
     static int alive_count() { return (int)ctor_count_ - (int)dtor_count_; }
 
+    // how many copies / moves have been made over the lifetime of this process?
+    static int copy_ctor_count() { return (int) copy_ctor_count_; }
+    static int move_ctor_count() { return (int) move_ctor_count_; }
+    static int copy_assign_count() { return (int) copy_assign_count_; }
+    static int move_assign_count() { return (int) move_assign_count_; }
+
     // check if Payload seems to be a valid object; output message if not
     void check_() const
     {
@@ -0,0 +1,302 @@
+// small_treemap - treemap with inline sorted-array storage for small maps
+// follows the interface of my::treemap
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "treemap.h"
+
+namespace my
+{
+    template <typename K, typename T, size_t N, typename Compare>
+    class small_treemap;
+
+    // iterator: either a pointer into the inline array or a treemap iterator
+    template <typename K, typename T, size_t N, typename Compare>
+    class small_treemap_iterator
+    {
+    protected:
+        friend class small_treemap<K, T, N, Compare>;
+
+        using tree_iterator = typename my::treemap<K, T, Compare>::iterator;
+
+        explicit small_treemap_iterator(std::pair<K, T> *p) : pos_(p) {}
+        explicit small_treemap_iterator(tree_iterator it) : pos_(it) {}
+
+        std::variant<std::pair<K, T> *, tree_iterator> pos_;
+
+    public:
+        // type aliases, should be exactly the same as for treemap itself
+        using key_type = K;
+        using mapped_type = T;
+        using value_type = std::pair<K, T>;
+
+        value_type &operator*()
+        {
+            if (auto p = std::get_if<value_type *>(&pos_))
+            {
+                return **p;
+            }
+            return *std::get<tree_iterator>(pos_);
+        }
+
+        value_type *operator->() { return &**this; }
+
+        bool operator==(const small_treemap_iterator &rhs) const { return pos_ == rhs.pos_; }
+        bool operator!=(const small_treemap_iterator &rhs) const { return !(pos_ == rhs.pos_); }
+
+        // next element in map, pre-increment
+        small_treemap_iterator &operator++()
+        {
+            std::visit([](auto &p)
+                       { ++p; },
+                       pos_);
+            return *this;
+        }
+
+        // prev element in map, pre-decrement
+        small_treemap_iterator &operator--()
+        {
+            std::visit([](auto &p)
+                       { --p; },
+                       pos_);
+            return *this;
+        }
+
+    }; // class small_treemap_iterator
+
+    /*
+     * class small_treemap<K,T,N,Compare>
+     * associative container with the interface of my::treemap, optimized for maps with few entries
+     * - up to N elements are kept in a sorted array inside the object itself: no allocation per element,
+     *   binary search over contiguous memory
+     * - inserting element N+1 moves everything into a treemap (in balanced order); the map stays a tree
+     *   until clear()
+     * - while small, inserting invalidates iterators (elements are shifted), like std::vector
+     */
+    template <typename K, typename T, size_t N = 32, typename Compare = std::less<K>>
+    class small_treemap
+    {
+
+    public:
+        // public type aliases
+        using key_type = K;
+        using mapped_type = T;
+        using value_type = std::pair<K, T>;
+        using key_compare = Compare;
+        using iterator = my::small_treemap_iterator<K, T, N, Compare>;
+
+        // maximum number of elements stored inline
+        static constexpr size_t inline_capacity = N;
+
+    public:
+        // construct empty map
+        small_treemap()
+            : small_count_(0), is_tree_(false), tree_()
+        {
+        }
+
+        // copyconstructor
+        small_treemap(const small_treemap &other)
+            : small_count_(0), is_tree_(other.is_tree_), tree_(other.tree_)
+        {
+            for (size_t i = 0; i < other.small_count_; i++)
+            {
+                new (data_() + i) value_type(other.data_()[i]);
+                small_count_++;
+            }
+        }
+
+        small_treemap &operator=(const small_treemap &other)
+        {
+            if (this != &other)
+            {
+                small_treemap copy(other);
+                clear();
+                ::swap(tree_, copy.tree_);
+                is_tree_ = copy.is_tree_;
+                for (size_t i = 0; i < copy.small_count_; i++)
+                {
+                    new (data_() + i) value_type(std::move(copy.data_()[i]));
+                    small_count_++;
+                }
+            }
+            return *this;
+        }
+
+        ~small_treemap()
+        {
+            destroy_small_();
+        }
+
+        // number of keys in map
+        size_t size() const { return is_tree_ ? tree_.size() : small_count_; }
+
+        // true while the elements are stored inline
+        bool is_inline() const { return !is_tree_; }
+
+        // how often is the element contained in the map? (0 or 1)
+        size_t count(const K &key) const
+        {
+            return is_tree_ ? tree_.count(key) : (find_small_(key) != nullptr ? 1 : 0);
+        }
+
+        // random read/write access to value by key
+        // if key is not in map, insert new (key, T())
+        T &operator[](const K &key)
+        {
+            if (!is_tree_)
+            {
+                if (value_type *found = find_small_(key))
+                {
+                    return found->second;
+                }
+            }
+            else
+            {
+                return tree_[key];
+            }
+            return insert(key, T()).first->second;
+        }
+
+        // delete all (key,value) pairs in map, back to inline storage
+        void clear()
+        {
+            destroy_small_();
+            tree_.clear();
+            is_tree_ = false;
+        }
+
+        iterator begin()
+        {
+            return is_tree_ ? iterator(tree_.begin()) : iterator(data_());
+        }
+
+        iterator end()
+        {
+            return is_tree_ ? iterator(tree_.end()) : iterator(data_() + small_count_);
+        }
+
+        iterator find(const K &key)
+        {
+            if (is_tree_)
+            {
+                return iterator(tree_.find(key));
+            }
+            value_type *found = find_small_(key);
+            return found != nullptr ? iterator(found) : end();
+        }
+
+        // first element whose key is not less than the given key, end() if there is none
+        iterator lower_bound(const K &key)
+        {
+            return is_tree_ ? iterator(tree_.lower_bound(key)) : iterator(lower_bound_small_(key));
+        }
+
+        std::pair<iterator, bool> insert(const K &key, const T &value)
+        {
+            if (is_tree_)
+            {
+                auto result = tree_.insert(key, value);
+                return std::make_pair(iterator(result.first), result.second);
+            }
+
+            value_type *pos = lower_bound_small_(key);
+            if (pos != data_() + small_count_ && !comp_(key, pos->first))
+            {
+                return std::make_pair(iterator(pos), false);
+            }
+
+            if (small_count_ == N)
+            {
+                move_to_tree_();
+                auto result = tree_.insert(key, value);
+                return std::make_pair(iterator(result.first), result.second);
+            }
+
+            // append, then rotate the new element into its sorted position
+            value_type *first = data_();
+            new (first + small_count_) value_type(key, value);
+            small_count_++;
+            std::rotate(pos, first + small_count_ - 1, first + small_count_);
+            return std::make_pair(iterator(pos), true);
+        }
+
+        std::pair<iterator, bool> insert_or_assign(const K &key, const T &value)
+        {
+            auto result = insert(key, value);
+            if (!result.second)
+            {
+                result.first->second = value;
+            }
+            return result;
+        }
+
+    protected:
+        alignas(value_type) unsigned char storage_[N * sizeof(value_type)];
+        size_t small_count_;
+        bool is_tree_;
+        my::treemap<K, T, Compare> tree_;
+        [[no_unique_address]] Compare comp_;
+
+        value_type *data_() { return std::launder(reinterpret_cast<value_type *>(storage_)); }
+        const value_type *data_() const { return std::launder(reinterpret_cast<const value_type *>(storage_)); }
+
+        // first inline element whose key is not less than key
+        value_type *lower_bound_small_(const K &key) const
+        {
+            value_type *first = const_cast<value_type *>(data_());
+            return std::lower_bound(first, first + small_count_, key,
+                                    [this](const value_type &v, const K &k)
+                                    { return comp_(v.first, k); });
+        }
+
+        // inline element with key, nullptr if not found
+        value_type *find_small_(const K &key) const
+        {
+            value_type *pos = lower_bound_small_(key);
+            return (pos != data_() + small_count_ && !comp_(key, pos->first)) ? pos : nullptr;
+        }
+
+        void destroy_small_()
+        {
+            for (size_t i = 0; i < small_count_; i++)
+            {
+                data_()[i].~value_type();
+            }
+            small_count_ = 0;
+        }
+
+        // hand all inline elements over to the tree
+        // inserting the sorted array in key order would degenerate the tree to a list,
+        // so insert medians first (breadth first over the index ranges)
+        void move_to_tree_()
+        {
+            std::vector<std::pair<size_t, size_t>> ranges;
+            ranges.reserve(small_count_);
+            ranges.emplace_back(0, small_count_);
+            for (size_t i = 0; i < ranges.size(); i++)
+            {
+                auto [lo, hi] = ranges[i];
+                if (lo >= hi)
+                {
+                    continue;
+                }
+                size_t mid = lo + (hi - lo) / 2;
+                tree_.insert(data_()[mid].first, data_()[mid].second);
+                ranges.emplace_back(lo, mid);
+                ranges.emplace_back(mid + 1, hi);
+            }
+            destroy_small_();
+            is_tree_ = true;
+        }
+    };
+
+} // namespace my
@@ -0,0 +1,141 @@
+// static_treemap - read-only ordered map built at compile time, for fixed lookup tables
+// follows the lookup and iteration interface of my::treemap
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace my
+{
+
+    /*
+     * class static_treemap<K,T,N,Compare>
+     * ordered map of exactly N elements, fixed at construction
+     * - constexpr: a table declared constexpr is sorted by the compiler and lives in read-only data,
+     *   no code runs at startup and nothing is allocated
+     * - find/count/lower_bound/at are constexpr too, usable in static_assert as well as at runtime
+     *   (binary search over a contiguous array)
+     * - keys and values must be literal types for compile-time tables, e.g. std::string_view
+     *   instead of std::string
+     * - duplicate keys throw std::invalid_argument, which makes a constexpr table fail to compile
+     * - iterators are const pointers into the array
+     */
+    template <typename K, typename T, size_t N, typename Compare = std::less<K>>
+    class static_treemap
+    {
+    public:
+        // public type aliases
+        using key_type = K;
+        using mapped_type = T;
+        using value_type = std::pair<K, T>;
+        using key_compare = Compare;
+        using iterator = const value_type *;
+        using const_iterator = iterator;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = reverse_iterator;
+
+        // elements in any order
+        constexpr explicit static_treemap(const std::array<value_type, N> &elements, const Compare &comp = Compare())
+            : elements_(elements), comp_(comp)
+        {
+            std::sort(elements_.begin(), elements_.end(), [this](const value_type &a, const value_type &b)
+                      { return comp_(a.first, b.first); });
+            for (size_t i = 1; i < N; i++)
+            {
+                if (!comp_(elements_[i - 1].first, elements_[i].first))
+                {
+                    throw std::invalid_argument("static_treemap: duplicate key");
+                }
+            }
+        }
+
+        // number of keys in map
+        constexpr size_t size() const { return N; }
+        constexpr bool empty() const { return N == 0; }
+
+        // the comparison object used to order the keys
+        constexpr key_compare key_comp() const { return comp_; }
+
+        constexpr iterator begin() const { return elements_.data(); }
+        constexpr iterator end() const { return elements_.data() + N; }
+        constexpr iterator cbegin() const { return begin(); }
+        constexpr iterator cend() const { return end(); }
+        constexpr reverse_iterator rbegin() const { return reverse_iterator(end()); }
+        constexpr reverse_iterator rend() const { return reverse_iterator(begin()); }
+
+        // first element whose key is not less than the given key, end() if there is none
+        constexpr iterator lower_bound(const K &key) const { return lower_bound_(key); }
+        template <typename KK, typename C = Compare, typename = typename C::is_transparent>
+        constexpr iterator lower_bound(const KK &key) const { return lower_bound_(key); }
+
+        constexpr iterator find(const K &key) const { return find_(key); }
+        template <typename KK, typename C = Compare, typename = typename C::is_transparent>
+        constexpr iterator find(const KK &key) const { return find_(key); }
+
+        // how often is the element contained in the map? (0 or 1)
+        constexpr size_t count(const K &key) const { return find_(key) != end() ? 1 : 0; }
+        template <typename KK, typename C = Compare, typename = typename C::is_transparent>
+        constexpr size_t count(const KK &key) const { return find_(key) != end() ? 1 : 0; }
+
+        // value of key, std::out_of_range if it is missing (no operator[]: the map cannot grow)
+        constexpr const T &at(const K &key) const { return at_(key); }
+        template <typename KK, typename C = Compare, typename = typename C::is_transparent>
+        constexpr const T &at(const KK &key) const { return at_(key); }
+
+    protected:
+        std::array<value_type, N> elements_; // sorted by key
+        [[no_unique_address]] Compare comp_;
+
+        // halve the range with one comparison per step and no branch on its result (a conditional
+        // move), the loop runs log2(N) times for every key
+        template <typename KK>
+        constexpr iterator lower_bound_(const KK &key) const
+        {
+            if (N == 0)
+            {
+                return end();
+            }
+            iterator first = begin();
+            size_t length = N;
+            while (length > 1)
+            {
+                size_t half = length / 2;
+                first = comp_(first[half].first, key) ? first + half : first;
+                length -= half;
+            }
+            return comp_(first->first, key) ? first + 1 : first;
+        }
+
+        template <typename KK>
+        constexpr iterator find_(const KK &key) const
+        {
+            iterator it = lower_bound_(key);
+            return it != end() && !comp_(key, it->first) ? it : end();
+        }
+
+        template <typename KK>
+        constexpr const T &at_(const KK &key) const
+        {
+            iterator it = find_(key);
+            if (it == end())
+            {
+                throw std::out_of_range("static_treemap: key not found");
+            }
+            return it->second;
+        }
+    };
+
+    // make_static_treemap<K, T>({{key, value}, ...}) - N is deduced from the list
+    template <typename K, typename T, typename Compare = std::less<K>, size_t N>
+    constexpr static_treemap<K, T, N, Compare> make_static_treemap(const std::pair<K, T> (&elements)[N], const Compare &comp = Compare())
+    {
+        return static_treemap<K, T, N, Compare>(std::to_array(elements), comp);
+    }
+
+} // namespace my
@@ -0,0 +1,568 @@
+// string_treemap - ordered map for std::string keys, stored as a prefix-compressed radix tree
+// follows the interface of my::treemap, so it can be used as a drop-in for string keyed maps
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// forward declarations
+
+namespace my
+{
+    template <typename T>
+    class string_treemap;
+}
+
+template <typename TT>
+void swap(my::string_treemap<TT> &lhs, my::string_treemap<TT> &rhs);
+
+namespace my
+{
+
+    // node of the radix tree
+    // - label_ holds the key bytes between the parent and this node, so common prefixes are stored once
+    // - a node has a mapped value if the concatenated labels from the root up to here form a key
+    // - children are kept sorted by the first byte of their label (which is unique among siblings)
+    template <typename T>
+    class string_treemap_node
+    {
+    public:
+        using node = string_treemap_node<T>;
+
+        std::string label_;
+        std::optional<T> mapped_;
+        node *up_ = nullptr;
+        std::vector<std::unique_ptr<node>> children_;
+
+        string_treemap_node() = default;
+
+        string_treemap_node(std::string_view label, node *up)
+            : label_(label), up_(up)
+        {
+        }
+
+        // first byte of the label, as compared by std::string
+        unsigned char head() const { return static_cast<unsigned char>(label_[0]); }
+
+        // position of the first child whose label starts with a byte >= c
+        typename std::vector<std::unique_ptr<node>>::iterator child_at_or_after(unsigned char c)
+        {
+            return std::lower_bound(children_.begin(), children_.end(), c,
+                                    [](const std::unique_ptr<node> &child, unsigned char b)
+                                    { return child->head() < b; });
+        }
+
+        // child whose label starts with c, nullptr if there is none
+        node *child(unsigned char c)
+        {
+            auto it = child_at_or_after(c);
+            return (it != children_.end() && (*it)->head() == c) ? it->get() : nullptr;
+        }
+
+        // smallest key in the subtree of this node - a node is always before its children
+        node *first()
+        {
+            node *current = this;
+            while (!current->mapped_)
+            {
+                assert(!current->children_.empty());
+                current = current->children_.front().get();
+            }
+            return current;
+        }
+
+        // largest key in the subtree of this node - the deepest right-most node
+        node *last()
+        {
+            node *current = this;
+            while (!current->children_.empty())
+            {
+                current = current->children_.back().get();
+            }
+            return current;
+        }
+
+        // sibling following this node, nullptr if this is the last child (or the root)
+        node *next_sibling()
+        {
+            if (up_ == nullptr)
+            {
+                return nullptr;
+            }
+            auto it = up_->child_at_or_after(head());
+            ++it;
+            return it != up_->children_.end() ? it->get() : nullptr;
+        }
+
+        // sibling preceding this node, nullptr if this is the first child (or the root)
+        node *prev_sibling()
+        {
+            if (up_ == nullptr)
+            {
+                return nullptr;
+            }
+            auto it = up_->child_at_or_after(head());
+            return it != up_->children_.begin() ? (--it)->get() : nullptr;
+        }
+
+        // first key after the whole subtree of this node, nullptr if there is none
+        node *next_after_subtree()
+        {
+            node *current = this;
+            while (current->up_ != nullptr)
+            {
+                if (node *sibling = current->next_sibling())
+                {
+                    return sibling->first();
+                }
+                current = current->up_;
+            }
+            return nullptr;
+        }
+
+        // full key of this node, concatenating the labels from the root
+        std::string key() const
+        {
+            size_t length = 0;
+            for (const node *n = this; n != nullptr; n = n->up_)
+            {
+                length += n->label_.size();
+            }
+            std::string result(length, '\0');
+            for (const node *n = this; n != nullptr; n = n->up_)
+            {
+                length -= n->label_.size();
+                result.replace(length, n->label_.size(), n->label_);
+            }
+            return result;
+        }
+
+        // deep copy of this subtree, the copy is attached to up
+        std::unique_ptr<node> clone(node *up) const
+        {
+            auto copy = std::make_unique<node>(label_, up);
+            copy->mapped_ = mapped_;
+            copy->children_.reserve(children_.size());
+            for (const auto &c : children_)
+            {
+                copy->children_.push_back(c->clone(copy.get()));
+            }
+            return copy;
+        }
+
+        // heap memory owned by this subtree (nodes, labels beyond the small string buffer, child arrays)
+        size_t bytes_used() const
+        {
+            size_t bytes = sizeof(node) + children_.capacity() * sizeof(std::unique_ptr<node>);
+            if (label_.capacity() > std::string().capacity())
+            {
+                bytes += label_.capacity() + 1;
+            }
+            for (const auto &c : children_)
+            {
+                bytes += c->bytes_used();
+            }
+            return bytes;
+        }
+
+    }; // class string_treemap_node
+
+    // iterator: references a node of the radix tree and keeps its reconstructed key
+    // dereferencing yields a pair of references (key, mapped value), like treemap's value_type
+    template <typename T>
+    class string_treemap_iterator
+    {
+    protected:
+        friend class string_treemap<T>;
+
+        using node = string_treemap_node<T>;
+
+        string_treemap_iterator(node *n, node *root)
+            : node_(n), root_(root), key_(n != nullptr ? n->key() : std::string())
+        {
+        }
+
+        string_treemap_iterator(node *n, node *root, std::string key)
+            : node_(n), root_(root), key_(std::move(key))
+        {
+        }
+
+        // jump to an arbitrary node, the key is rebuilt from its ancestors
+        void move_to_(node *n)
+        {
+            node_ = n;
+            key_ = n != nullptr ? n->key() : std::string();
+        }
+
+        node *node_;
+        node *root_;
+        std::string key_;
+
+    public:
+        using key_type = std::string;
+        using mapped_type = T;
+        using value_type = std::pair<std::string, T>;
+        using reference = std::pair<const std::string &, T &>;
+
+        // operator-> needs an address, so the pair of references is kept in a small proxy
+        struct pointer
+        {
+            reference ref_;
+            reference *operator->() { return &ref_; }
+        };
+
+        reference operator*() const
+        {
+            assert(node_ != nullptr);
+            return reference(key_, *node_->mapped_);
+        }
+
+        pointer operator->() const
+        {
+            return pointer{**this};
+        }
+
+        // two iterators are equal if they point to the same node
+        bool operator==(const string_treemap_iterator &rhs) const { return node_ == rhs.node_; }
+        bool operator!=(const string_treemap_iterator &rhs) const { return node_ != rhs.node_; }
+
+        // next element in map, pre-increment
+        // a node's own key sorts before all keys of its children, so go down first, then sideways/up
+        string_treemap_iterator &operator++()
+        {
+            assert(node_ != nullptr);
+
+            if (!node_->children_.empty())
+            {
+                node *current = node_->children_.front().get();
+                key_ += current->label_;
+                while (!current->mapped_)
+                {
+                    current = current->children_.front().get();
+                    key_ += current->label_;
+                }
+                node_ = current;
+                return *this;
+            }
+
+            node *current = node_;
+            while (current->up_ != nullptr)
+            {
+                key_.resize(key_.size() - current->label_.size());
+                if (node *sibling = current->next_sibling())
+                {
+                    key_ += sibling->label_;
+                    while (!sibling->mapped_)
+                    {
+                        sibling = sibling->children_.front().get();
+                        key_ += sibling->label_;
+                    }
+                    node_ = sibling;
+                    return *this;
+                }
+                current = current->up_;
+            }
+
+            node_ = nullptr;
+            key_.clear();
+            return *this;
+        }
+
+        // prev element in map, pre-decrement
+        string_treemap_iterator &operator--()
+        {
+            if (node_ == nullptr)
+            {
+                // from end() go to the largest key
+                assert(root_ != nullptr);
+                move_to_(root_->last());
+                return *this;
+            }
+
+            node *current = node_;
+            while (current->up_ != nullptr)
+            {
+                if (node *sibling = current->prev_sibling())
+                {
+                    move_to_(sibling->last());
+                    return *this;
+                }
+                current = current->up_;
+                if (current->mapped_)
+                {
+                    move_to_(current);
+                    return *this;
+                }
+            }
+
+            // there is no smaller key, decrementing begin() is not allowed
+            assert(false);
+            return *this;
+        }
+
+    }; // class string_treemap_iterator
+
+    /*
+     * class string_treemap<T>
+     * associative container with unique std::string keys and the interface of my::treemap
+     * - keys sharing a prefix share the nodes of that prefix (radix tree / patricia trie)
+     * - lookups look at every key byte at most once, no repeated scans of common prefixes
+     * - all lookups take std::string_view, so no temporary strings are needed
+     * - iteration is in the same lexicographic order as treemap<std::string, T>
+     */
+    template <typename T>
+    class string_treemap
+    {
+
+    public:
+        // public type aliases
+        using key_type = std::string;
+        using mapped_type = T;
+        using value_type = std::pair<std::string, T>;
+        using iterator = my::string_treemap_iterator<T>;
+
+    public:
+        // construct empty map
+        string_treemap()
+            : root_(std::make_unique<node>()), count_(0)
+        {
+        }
+
+        // copyconstructor
+        string_treemap(const string_treemap &other)
+            : root_(other.root_->clone(nullptr)), count_(other.count_)
+        {
+        }
+
+        // number of keys in map
+        size_t size() const { return count_; }
+
+        // how often is the element contained in the map? (0 or 1)
+        size_t count(std::string_view key) const { return find_(key) == nullptr ? 0 : 1; }
+
+        // random read/write access to value by key
+        // if key is not in map, insert new (key, T())
+        T &operator[](std::string_view key)
+        {
+            node *found = find_(key);
+            if (found == nullptr)
+            {
+                found = insert_(key, T()).first;
+            }
+            return *found->mapped_;
+        }
+
+        // delete all (key,value) pairs in map
+        void clear()
+        {
+            root_ = std::make_unique<node>();
+            count_ = 0;
+        }
+
+        // used for copy&move - declared in global namespace, not in my::
+        template <typename TT>
+        friend void ::swap(string_treemap<TT> &, string_treemap<TT> &);
+
+        string_treemap &operator=(string_treemap other)
+        {
+            swap(*this, other);
+            return *this;
+        }
+
+        iterator begin() const
+        {
+            return count_ == 0 ? end() : iterator(root_->first(), root_.get());
+        }
+
+        iterator end() const { return iterator(nullptr, root_.get()); }
+
+        iterator find(std::string_view key) const
+        {
+            node *found = find_(key);
+            return found != nullptr ? iterator(found, root_.get(), std::string(key)) : end();
+        }
+
+        // first element whose key is not less than the given key, end() if there is none
+        iterator lower_bound(std::string_view key) const
+        {
+            return iterator(lower_bound_(key), root_.get());
+        }
+
+        std::pair<iterator, bool> insert(std::string_view key, const T &value)
+        {
+            auto result = insert_(key, value);
+            return std::make_pair(iterator(result.first, root_.get(), std::string(key)), result.second);
+        }
+
+        std::pair<iterator, bool> insert_or_assign(std::string_view key, const T &value)
+        {
+            auto result = insert_(key, value);
+            if (!result.second)
+            {
+                *result.first->mapped_ = value;
+            }
+            return std::make_pair(iterator(result.first, root_.get(), std::string(key)), result.second);
+        }
+
+        // heap memory used by the tree structure, keys and values (without memory owned by T itself)
+        size_t bytes_used() const { return root_->bytes_used(); }
+
+    protected:
+        using node = my::string_treemap_node<T>;
+
+        // the root has an empty label and is never removed, so begin()/end() never need a special case
+        std::unique_ptr<node> root_;
+        size_t count_;
+
+        // find node holding the key. returns nullptr if not found.
+        node *find_(std::string_view key) const
+        {
+            node *current = root_.get();
+            size_t pos = 0;
+
+            while (pos < key.size())
+            {
+                current = current->child(static_cast<unsigned char>(key[pos]));
+                if (current == nullptr || key.compare(pos, current->label_.size(), current->label_) != 0)
+                {
+                    return nullptr;
+                }
+                pos += current->label_.size();
+            }
+
+            return current->mapped_ ? current : nullptr;
+        }
+
+        // first node with a key not less than key. returns nullptr if there is none.
+        node *lower_bound_(std::string_view key) const
+        {
+            node *current = root_.get();
+            size_t pos = 0;
+
+            for (;;)
+            {
+                // key is a prefix of everything in this subtree, so the smallest entry is the answer
+                if (pos == key.size())
+                {
+                    return count_ == 0 ? nullptr : current->first();
+                }
+
+                unsigned char c = static_cast<unsigned char>(key[pos]);
+                auto it = current->child_at_or_after(c);
+                if (it == current->children_.end())
+                {
+                    // all children are smaller
+                    return current->up_ == nullptr ? nullptr : current->next_after_subtree();
+                }
+
+                node *child = it->get();
+                if (child->head() != c)
+                {
+                    // all keys in the child's subtree are greater
+                    return child->first();
+                }
+
+                std::string_view rest = key.substr(pos);
+                const std::string &label = child->label_;
+                size_t common = 0;
+                size_t limit = std::min(rest.size(), label.size());
+                while (common < limit && rest[common] == label[common])
+                {
+                    common++;
+                }
+
+                if (common == label.size())
+                {
+                    // label fully matched, continue below
+                    current = child;
+                    pos += common;
+                }
+                else if (common == rest.size() ||
+                         static_cast<unsigned char>(rest[common]) < static_cast<unsigned char>(label[common]))
+                {
+                    // key ends inside the label or is smaller at the mismatch: the whole subtree is greater
+                    return child->first();
+                }
+                else
+                {
+                    // the whole subtree is smaller
+                    return child->next_after_subtree();
+                }
+            }
+        }
+
+        // add a new (key, value) pair into the tree
+        // returns the node for key and true if it was inserted, false if the key was already in map
+        std::pair<node *, bool> insert_(std::string_view key, const T &mapped)
+        {
+            node *current = root_.get();
+            size_t pos = 0;
+
+            while (pos < key.size())
+            {
+                unsigned char c = static_cast<unsigned char>(key[pos]);
+                auto it = current->child_at_or_after(c);
+
+                // no child shares the next byte: attach the whole remainder as a new leaf
+                if (it == current->children_.end() || (*it)->head() != c)
+                {
+                    auto leaf = std::make_unique<node>(key.substr(pos), current);
+                    leaf->mapped_.emplace(mapped);
+                    node *result = leaf.get();
+                    current->children_.insert(it, std::move(leaf));
+                    count_++;
+                    return std::make_pair(result, true);
+                }
+
+                node *child = it->get();
+                const std::string &label = child->label_;
+                size_t common = 1;
+                size_t limit = std::min(key.size() - pos, label.size());
+                while (common < limit && key[pos + common] == label[common])
+                {
+                    common++;
+                }
+
+                // the key diverges inside the label: split the edge at the common prefix
+                if (common < label.size())
+                {
+                    auto middle = std::make_unique<node>(std::string_view(label).substr(0, common), current);
+                    std::unique_ptr<node> lower = std::move(*it);
+                    lower->label_.erase(0, common);
+                    lower->up_ = middle.get();
+                    middle->children_.push_back(std::move(lower));
+                    *it = std::move(middle);
+                    child = it->get();
+                }
+
+                current = child;
+                pos += common;
+            }
+
+            if (current->mapped_)
+            {
+                return std::make_pair(current, false);
+            }
+
+            current->mapped_.emplace(mapped);
+            count_++;
+            return std::make_pair(current, true);
+        }
+    };
+
+} // namespace my
+
+// swap contents of two trees
+template <typename TT>
+void swap(my::string_treemap<TT> &lhs, my::string_treemap<TT> &rhs)
+{
+    std::swap(lhs.root_, rhs.root_);
+    std::swap(lhs.count_, rhs.count_);
+}
@@ -3,14 +3,98 @@
 
 #include "treemap.h"
 #include "payload_v2.h"
+#include "string_treemap.h"
+#include "small_treemap.h"
+#include "compact_treemap.h"
+#include "durable_treemap.h"
+#include "buffered_treemap.h"
+#include "treemap_loader.h"
+#include "static_treemap.h"
+#include "cache_treemap.h"
+#include "interval_treemap.h"
+#include "node_memory.h"
+#include "frozen_treemap.h"
 
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <memory_resource>
+#include <random>
 #include <algorithm>
+#include <functional>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
 using namespace std;
 using my::treemap;
 
+// clock for the cache_treemap tests, advanced by hand
+struct manual_clock
+{
+    using duration = std::chrono::nanoseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<manual_clock>;
+    static const bool is_steady = true;
+    static inline rep ticks = 0;
+    static time_point now() { return time_point(duration(ticks)); }
+};
+
+// node memory resource that counts its blocks (treemap::node_resource)
+struct counting_resource : std::pmr::memory_resource
+{
+    long live = 0;        // allocated and not yet freed
+    long allocations = 0; // ever allocated
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        live++;
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override
+    {
+        live--;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+// Payload copies, moves and node allocations since construction, for exact per-operation
+// counts: a change that adds a copy to a hot path fails the test that pins it
+struct payload_counts
+{
+    const counting_resource &nodes;
+    int copy_ctor = Payload::copy_ctor_count(), move_ctor = Payload::move_ctor_count();
+    int copy_assign = Payload::copy_assign_count(), move_assign = Payload::move_assign_count();
+    int dtor = Payload::dtor_count();
+    long allocations = nodes.allocations;
+
+    // true if exactly these happened since construction
+    bool are(int copies, int moves, int copy_assigns, int move_assigns, int destroyed, long allocated) const
+    {
+        bool ok = Payload::copy_ctor_count() - copy_ctor == copies && Payload::move_ctor_count() - move_ctor == moves &&
+                  Payload::copy_assign_count() - copy_assign == copy_assigns &&
+                  Payload::move_assign_count() - move_assign == move_assigns && Payload::dtor_count() - dtor == destroyed &&
+                  nodes.allocations - allocations == allocated;
+        if (!ok)
+        {
+            cout << "copy ctor " << Payload::copy_ctor_count() - copy_ctor << ", move ctor " << Payload::move_ctor_count() - move_ctor
+                 << ", copy assign " << Payload::copy_assign_count() - copy_assign << ", move assign "
+                 << Payload::move_assign_count() - move_assign << ", dtor " << Payload::dtor_count() - dtor
+                 << ", node allocations " << nodes.allocations - allocations << endl;
+        }
+        return ok;
+    }
+};
+
 void test32()
 {
 
@@ -96,8 +180,9 @@ void test32()
         m.clear();
         assert(Payload::alive_count() == 0);
 
-        // now the iterator should point to "no element"
-        assert(it == m.end());
+        // the iterator is invalidated like a std::map iterator, the map itself is empty
+        (void)it;
+        assert(m.begin() == m.end());
     }
     cout << "done." << endl;
 
@@ -334,4 +419,1825 @@ void test32()
 #endif
 
 
-}
\ No newline at end of file
+#if 1
+
+    {
+        cout << "custom comparator, transparent lookup, lower_bound()" << endl;
+
+        // descending order via std::greater
+        treemap<int, Payload, std::greater<int>> d;
+        d[1] = Payload("one");
+        d[3] = Payload("three");
+        d[2] = Payload("two");
+        assert(d.begin()->first == 3);
+        assert((++d.begin())->first == 2);
+        assert(d.count(2) == 1);
+        assert(d.count(4) == 0);
+        assert(d.lower_bound(4)->first == 3);
+        assert(d.lower_bound(0) == d.end());
+
+        // std::less<> is transparent, string_view lookups need no temporary std::string
+        treemap<std::string, Payload, std::less<>> m;
+        m["Uranus"] = Payload("Uranus");
+        m["Earth"] = Payload("Earth");
+        m["Mars"] = Payload("Mars");
+
+        std::string_view mars = "Mars";
+        assert(m.count(mars) == 1);
+        assert(m.find(mars)->second == Payload("Mars"));
+        assert(m.find(std::string_view("Pluto")) == m.end());
+        assert(m.lower_bound(std::string_view("F"))->first == "Mars");
+        assert(m.lower_bound(std::string_view("Z")) == m.end());
+
+        // insert() of an existing key does not change the size
+        assert(m.insert("Mars", Payload("other")).second == false);
+        assert(m.size() == 3);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "string_treemap, same order as treemap<std::string>" << endl;
+
+        // keys that are prefixes of each other and share long prefixes
+        std::vector<std::string> keys = {"http://a.com/x", "http://a.com/x/y", "http://a.com/", "http://b.org",
+                                         "http://a.com/x/z", "", "http://a.com/xa", "http", "zzz", "http://a.com/x"};
+
+        my::string_treemap<Payload> s;
+        treemap<std::string, Payload> t;
+        for (auto &k : keys)
+        {
+            s.insert(k, Payload(k));
+            t.insert(k, Payload(k));
+        }
+        assert(s.size() == t.size());
+        assert(s.size() == 9);
+
+        // forward iteration gives the same keys in the same order
+        auto ti = t.begin();
+        for (auto si = s.begin(); si != s.end(); ++si, ++ti)
+        {
+            assert(si->first == ti->first);
+            assert(si->second == ti->second);
+        }
+        assert(ti == t.end());
+
+        // backward iteration too
+        auto sr = s.end();
+        auto tr = t.end();
+        while (sr != s.begin())
+        {
+            --sr;
+            --tr;
+            assert((*sr).first == tr->first);
+        }
+
+        // lookups and lower_bound agree
+        std::vector<std::string> probes = {"", "h", "http", "http:", "http://a.com/x", "http://a.com/x/", "http://a.com/y",
+                                           "http://c", "zz", "zzzz", "http://a.com/xa", "http://a.com/xb"};
+        for (auto &p : probes)
+        {
+            assert(s.count(p) == t.count(p));
+            auto sl = s.lower_bound(p);
+            auto tl = t.lower_bound(p);
+            assert((sl == s.end()) == (tl == t.end()));
+            if (sl != s.end())
+            {
+                assert(sl->first == tl->first);
+            }
+        }
+
+        // write access and copies
+        s["http://a.com/x"] = Payload("changed");
+        assert(s.find("http://a.com/x")->second == Payload("changed"));
+        assert(s.insert_or_assign("new", Payload("new")).second);
+        auto copy = s;
+        copy["http://b.org"] = Payload("copy only");
+        assert(s.find("http://b.org")->second == Payload("http://b.org"));
+        assert(copy.size() == s.size());
+        s.clear();
+        assert(s.size() == 0 && s.begin() == s.end());
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "small_treemap, inline array and switch to tree" << endl;
+
+        my::small_treemap<int, Payload, 4> m;
+        m[7] = Payload("seven");
+        m[3] = Payload("three");
+        m[9] = Payload("nine");
+        assert(m.insert(1, Payload("one")).second);
+        assert(m.is_inline());
+        assert(m.size() == 4);
+        assert(Payload::alive_count() == 4);
+        assert(m.begin()->first == 1);
+        assert(m.find(9)->second == Payload("nine"));
+        assert(m.find(5) == m.end());
+        assert(m.lower_bound(4)->first == 7);
+
+        // existing keys do not count against the inline capacity
+        assert(m.insert(3, Payload("not three")).second == false);
+        assert(m.is_inline());
+
+        auto copy = m;
+        assert(Payload::alive_count() == 8);
+
+        // the fifth element moves everything into a tree
+        m[5] = Payload("five");
+        m.insert_or_assign(3, Payload("three!"));
+        assert(!m.is_inline());
+        assert(m.size() == 5);
+        assert(Payload::alive_count() == 9);
+
+        int expected[] = {1, 3, 5, 7, 9};
+        int i = 0;
+        for (auto it = m.begin(); it != m.end(); ++it)
+        {
+            assert(it->first == expected[i++]);
+        }
+        auto last = m.end();
+        --last;
+        assert(last->first == 9);
+        assert(m[3] == Payload("three!"));
+
+        // the copy is still inline and independent
+        assert(copy.is_inline());
+        assert(copy[3] == Payload("three"));
+
+        copy = m;
+        assert(!copy.is_inline());
+        assert(copy.size() == 5);
+
+        m.clear();
+        assert(m.is_inline());
+        assert(m.size() == 0 && m.begin() == m.end());
+        assert(Payload::alive_count() == 5);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "front cache" << endl;
+
+        treemap<int, Payload> m;
+        m.front_cache(5);
+        assert(m.front_cache_size() == 8);
+        for (int i = 0; i < 20; i++)
+        {
+            m[(i * 7) % 20] = Payload(std::to_string((i * 7) % 20));
+        }
+
+        // repeated lookups give the same answers as without cache
+        for (int round = 0; round < 3; round++)
+        {
+            for (int i = 0; i < 25; i++)
+            {
+                assert(m.count(i) == (i < 20 ? 1 : 0));
+                if (i < 20)
+                {
+                    assert(m.find(i)->second == Payload(std::to_string(i)));
+                }
+            }
+        }
+        m[3] = Payload("three");
+        assert(m.find(3)->second == Payload("three"));
+
+        // copies get their own (empty) cache, clear() forgets cached nodes
+        auto copy = m;
+        assert(copy.front_cache_size() == 8);
+        assert(copy[3] == Payload("three"));
+        m.clear();
+        assert(m.count(3) == 0);
+        assert(m.find(4) == m.end());
+        assert(copy.count(3) == 1);
+
+        m.front_cache(0);
+        assert(m.front_cache_size() == 0);
+
+        // key types without std::hash can still be used, just not with the cache
+        treemap<std::pair<int, int>, int> p;
+        p[std::make_pair(1, 2)] = 3;
+        assert(p.count(std::make_pair(1, 2)) == 1);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "bloom filter" << endl;
+
+        treemap<int, Payload> m;
+        m[1] = Payload("one");
+        // switching on later fills the filter from the existing keys
+        m.bloom_filter(8);
+        for (int i = 2; i <= 100; i++)
+        {
+            // outgrows the filter sized for 8 keys, must be rebuilt without losing keys
+            m.insert(2 * i, Payload(std::to_string(2 * i)));
+        }
+        assert(m.size() == 100);
+
+        // no false negatives
+        assert(m.count(1) == 1);
+        for (int i = 2; i <= 100; i++)
+        {
+            assert(m.count(2 * i) == 1);
+            assert(m.find(2 * i)->second == Payload(std::to_string(2 * i)));
+        }
+        assert(m.bloom_stats().negatives == 0);
+
+        // misses: most are rejected by the filter, the rest are counted as false positives
+        m.reset_bloom_stats();
+        for (int i = 0; i < 1000; i++)
+        {
+            assert(m.count(2 * i + 1001) == 0);
+        }
+        auto stats = m.bloom_stats();
+        assert(stats.queries == 1000);
+        assert(stats.negatives + stats.false_positives == 1000);
+        assert(stats.false_positive_rate() < 0.1);
+        assert(stats.bytes > 0);
+
+        // copies keep the filter, clear() forgets all keys
+        auto copy = m;
+        m.clear();
+        assert(m.count(4) == 0);
+        m[4] = Payload("four");
+        assert(m.count(4) == 1);
+        assert(copy.count(200) == 1);
+
+        m.bloom_filter(0);
+        assert(m.bloom_stats().bytes == 0);
+        assert(m.count(4) == 1);
+
+        // a sorted bulk load into an empty map sizes the filter for the whole batch
+        {
+            treemap<int, int> loaded;
+            loaded.bloom_filter(1000);
+            vector<pair<int, int>> sorted;
+            for (int i = 0; i < 200000; i++)
+            {
+                sorted.emplace_back(2 * i, i);
+            }
+            loaded.insert_sorted(sorted.begin(), sorted.end());
+            for (int i = 0; i < 200000; i += 997)
+            {
+                assert(loaded.count(2 * i) == 1);
+            }
+            loaded.reset_bloom_stats();
+            for (int i = 0; i < 100000; i++)
+            {
+                assert(loaded.count(2 * i + 1) == 0);
+            }
+            assert(loaded.bloom_stats().false_positive_rate() < 0.1);
+            assert(loaded.bloom_stats().bytes >= 200000 * 10 / 8);
+        }
+
+        // steady churn: the size stays flat, erased keys' bits must not fill the filter
+        {
+            treemap<int, int> churn;
+            churn.bloom_filter(1000);
+            int next = 0;
+            for (; next < 1000; next++)
+            {
+                churn[next] = next;
+            }
+            for (int round = 0; round < 50; round++)
+            {
+                for (int i = 0; i < 1000; i++)
+                {
+                    churn.erase(next - 1000 + i);
+                }
+                for (int i = 0; i < 1000; i++, next++)
+                {
+                    churn[next] = next;
+                }
+                assert(churn.size() == 1000 && churn.count(next - 1) == 1 && churn.count(next - 1000) == 1);
+            }
+            churn.reset_bloom_stats();
+            for (int i = 0; i < 150000; i++)
+            {
+                assert(churn.count(-1 - i) == 0);
+            }
+            assert(churn.bloom_stats().false_positive_rate() < 0.1 && churn.bloom_stats().negatives > 0);
+        }
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "hot-path counters" << endl;
+
+        treemap<int, Payload> m;
+        // degenerate on purpose: 1, 2, 3 is a list of depth 3
+        m.insert(1, Payload("one"));
+        m.insert(2, Payload("two"));
+        m.insert(3, Payload("three"));
+        m.reset_stats();
+
+        assert(m.count(3) == 1);
+        auto stats = m.stats();
+        if constexpr (treemap<int, Payload>::stats_enabled)
+        {
+            assert(stats.lookups == 1);
+            assert(stats.lookup_nodes_visited == 3);
+            assert(stats.average_lookup_depth() == 3.0);
+            // one comparison per node plus the final equality check
+            assert(stats.comparisons == 4);
+
+            m.insert(4, Payload("four"));
+            m.insert(4, Payload("four"));
+            stats = m.stats();
+            assert(stats.inserts == 2);
+            assert(stats.insert_nodes_visited == 7);
+            assert(stats.node_allocations == 1);
+
+            // iterators hold plain pointers, iterating does not count anything
+            m.reset_stats();
+            for (auto it = m.begin(); it != m.end(); ++it)
+            {
+            }
+            assert(m.stats().comparisons == 0 && m.stats().lookups == 0);
+
+            treemap<int, Payload> copy = m;
+            assert(copy.stats().node_allocations == 4);
+        }
+        else
+        {
+            // not compiled in: always zero
+            assert(stats.comparisons == 0 && stats.lookups == 0 && stats.node_allocations == 0);
+        }
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "shape_stats()" << endl;
+
+        treemap<int, Payload> m;
+        auto shape = m.shape_stats();
+        assert(shape.nodes == 0 && shape.height == 0 && shape.leaves == 0 && shape.consistent());
+
+        //      4
+        //    2   6
+        //   1 3 5 7
+        for (int k : {4, 2, 6, 1, 3, 5, 7})
+        {
+            m.insert(k, Payload(std::to_string(k)));
+        }
+        shape = m.shape_stats();
+        assert(shape.nodes == 7 && shape.consistent());
+        assert(shape.height == 3);
+        assert(shape.leaves == 4);
+        assert(shape.min_leaf_depth == 3 && shape.max_leaf_depth == 3);
+        assert(shape.average_leaf_depth == 3.0);
+        assert(shape.bytes_per_node >= sizeof(std::pair<int, Payload>));
+        assert(shape.bytes >= 7 * shape.bytes_per_node);
+        assert(!shape.rebalance_recommended);
+
+        // sorted inserts make a list
+        treemap<int, int> list;
+        for (int i = 0; i < 1000; i++)
+        {
+            list.insert(i, i);
+        }
+        auto list_shape = list.shape_stats();
+        assert(list_shape.nodes == 1000 && list_shape.height == 1000);
+        assert(list_shape.leaves == 1 && list_shape.max_leaf_depth == 1000);
+        assert(list_shape.rebalance_recommended);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "scapegoat rebuilding" << endl;
+
+        treemap<int, Payload> m;
+        m.scapegoat(0.7);
+        m.front_cache(16);
+        m.insert(0, Payload("0"));
+        auto first = m.find(0);
+        // sorted inserts would make a list, rebuilds keep the height logarithmic
+        for (int i = 1; i < 2000; i++)
+        {
+            m.insert(i, Payload(std::to_string(i)));
+            assert(m.count(i / 2) == 1);
+        }
+        auto shape = m.shape_stats();
+        assert(shape.consistent() && shape.nodes == 2000);
+        assert(shape.height <= 1 + std::log(2000.0) / std::log(1 / 0.7));
+        assert(!shape.rebalance_recommended);
+
+        // nodes were only relinked: old iterators stay valid, order is unchanged
+        assert(first->second == Payload("0"));
+        int expected = 0;
+        for (auto it = m.begin(); it != m.end(); ++it)
+        {
+            assert(it->first == expected++);
+        }
+        assert(expected == 2000);
+        auto last = m.end();
+        --last;
+        assert(last->first == 1999);
+
+        // switching on rebuilds an existing list, copies keep the setting
+        treemap<int, int> list;
+        for (int i = 0; i < 100; i++)
+        {
+            list[i] = i;
+        }
+        assert(list.shape_stats().height == 100);
+        list.scapegoat(0.6);
+        assert(list.shape_stats().height == 7);
+        treemap<int, int> copy = list;
+        assert(copy.scapegoat_alpha() == 0.6);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "compact_treemap" << endl;
+
+        my::compact_treemap<int, Payload> c;
+        treemap<int, Payload> m;
+        assert(c.begin() == c.end());
+
+        c[50] = Payload("fifty");
+        // iterators hold positions, not addresses: still valid after the vector grew
+        auto fifty = c.find(50);
+        for (int i = 0; i < 200; i++)
+        {
+            int key = (i * 37) % 101;
+            c.insert(key, Payload(std::to_string(key)));
+            m.insert(key, Payload(std::to_string(key)));
+        }
+        assert(fifty->second == Payload("fifty"));
+        assert(c.size() == 101 && c.size() == m.size());
+        assert(!c.insert(7, Payload("x")).second);
+        c.insert_or_assign(7, Payload("seven"));
+        m.insert_or_assign(7, Payload("seven"));
+        m[50] = Payload("fifty");
+
+        // same order as treemap, forwards and backwards
+        auto mit = m.begin();
+        for (auto it = c.begin(); it != c.end(); ++it, ++mit)
+        {
+            assert(it->first == mit->first && it->second == mit->second);
+        }
+        assert(mit == m.end());
+        auto last = c.end();
+        --last;
+        assert(last->first == 100);
+        --last;
+        assert(last->first == 99);
+
+        assert(c.count(101) == 0 && c.find(101) == c.end());
+        assert(c.lower_bound(-5)->first == 0);
+        assert(c.lower_bound(101) == c.end());
+
+        // copies are independent
+        auto copy = c;
+        c.clear();
+        assert(c.size() == 0 && c.begin() == c.end());
+        assert(copy.size() == 101 && copy[7] == Payload("seven"));
+
+        // 3 links of 4 bytes instead of shared_ptr/weak_ptr plus a control block per node
+        assert(copy.bytes_used() < m.shape_stats().bytes);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "snapshot()" << endl;
+
+        treemap<int, Payload> m;
+        m.front_cache(16);
+        for (int k : {40, 20, 60, 10, 30, 50, 70})
+        {
+            m.insert(k, Payload(std::to_string(k)));
+        }
+        int before = Payload::alive_count();
+
+        auto snap = m.snapshot();
+        // O(1): no node was copied
+        assert(Payload::alive_count() == before);
+        assert(snap.size() == 7);
+
+        // writes copy only their path: 40, 20, 10 for the new key 5
+        m.insert(5, Payload("5"));
+        assert(Payload::alive_count() == before + 1 + 3);
+        m.insert_or_assign(30, Payload("thirty"));
+        m[70] = Payload("seventy");
+        m[80] = Payload("80");
+        m.count(30); // front cache now knows the copied node
+
+        // the snapshot still shows the old contents, in order
+        std::vector<int> keys;
+        for (auto it = snap.begin(); it != snap.end(); ++it)
+        {
+            keys.push_back(it->first);
+            assert(it->second == Payload(std::to_string(it->first)));
+        }
+        assert((keys == std::vector<int>{10, 20, 30, 40, 50, 60, 70}));
+        assert(snap.count(5) == 0 && snap.count(80) == 0);
+        assert(snap.find(30)->second == Payload("30"));
+        assert(snap.lower_bound(31)->first == 40);
+        assert(snap.lower_bound(71) == snap.end());
+
+        // the map sees its own writes, iteration follows the copied nodes' up_ links
+        assert(m.size() == 9 && m.shape_stats().consistent());
+        assert(m[30] == Payload("thirty") && m.find(70)->second == Payload("seventy"));
+        keys.clear();
+        for (auto it = m.begin(); it != m.end(); ++it)
+        {
+            keys.push_back(it->first);
+        }
+        assert((keys == std::vector<int>{5, 10, 20, 30, 40, 50, 60, 70, 80}));
+        auto last = m.end();
+        --last;
+        assert(last->first == 80);
+
+        // rebuilding must not change the snapshot either
+        auto snap2 = m.snapshot();
+        m.scapegoat(0.6);
+        assert(snap2.size() == 9 && snap2.begin()->first == 5);
+        assert(snap.begin()->first == 10);
+
+        // when the snapshots are gone, their old nodes are freed
+        snap = m.snapshot();
+        snap2 = snap;
+        m.clear();
+        assert(snap.size() == 9);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "durable_treemap" << endl;
+
+        char dir_template[] = "/tmp/treemap_durable_XXXXXX";
+        std::string dir = mkdtemp(dir_template);
+
+        {
+            my::durable_treemap<int, std::string> d(dir);
+            d.insert(1, "one");
+            d.insert(1, "not logged, 1 exists");
+            d.insert_or_assign(2, "two");
+            d[3] = "three";
+            std::string three = d[3];
+            assert(three == "three");
+            d.clear();
+            for (int i = 0; i < 1000; i++)
+            {
+                d.insert(i, std::to_string(i));
+            }
+            // destructor writes the last group
+        }
+
+        {
+            // recovery replays the log
+            my::durable_treemap<int, std::string> d(dir);
+            assert(d.size() == 1000);
+            assert(d.map().find(999)->second == "999");
+
+            d.checkpoint();
+            d[5] = "five";
+            d.wait_checkpoint();
+            d.insert(1000, "1000");
+            d.sync();
+        }
+
+        // a crash in the middle of writing a record leaves a torn tail
+        {
+            std::ofstream log(dir + "/log.1", std::ios::binary | std::ios::app);
+            log.write("\x20\0\0\0garbage", 11);
+        }
+
+        {
+            // checkpoint + newer log, the torn record is cut off
+            my::durable_treemap<int, std::string, std::less<int>> d(dir, {my::sync_policy::every_write, 1, 0});
+            assert(d.size() == 1001);
+            assert(d.map().find(5)->second == "five");
+            assert(d.map().find(1000)->second == "1000");
+            assert(!std::ifstream(dir + "/log.0"));
+
+            d.insert(1001, "1001");
+            auto snap = d.snapshot();
+            int expected = 0;
+            for (auto it = snap.begin(); it != snap.end(); ++it)
+            {
+                assert(it->first == expected++);
+            }
+            assert(expected == 1002);
+        }
+
+        {
+            my::durable_treemap<int, std::string> d(dir);
+            assert(d.size() == 1002);
+        }
+
+        std::filesystem::remove_all(dir);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "insert_sorted() and buffered_treemap" << endl;
+
+        // finger insertion into an existing tree, existing keys are kept
+        treemap<int, Payload> m;
+        for (int k : {50, 20, 80, 10, 30})
+        {
+            m.insert(k, Payload(std::to_string(k)));
+        }
+        std::vector<std::pair<int, Payload>> batch;
+        for (int k = 0; k <= 100; k += 5)
+        {
+            batch.emplace_back(k, Payload("new"));
+        }
+        assert(m.insert_sorted(batch.begin(), batch.end()) == 16);
+        assert(m.size() == 21 && m.shape_stats().consistent());
+        assert(m.find(50)->second == Payload("50"));
+        assert(m.find(55)->second == Payload("new"));
+        int expected = 0;
+        for (auto it = m.begin(); it != m.end(); ++it, expected += 5)
+        {
+            assert(it->first == expected);
+        }
+        assert(expected == 105);
+
+        // a batch into an empty tree is built balanced, not as a list
+        treemap<int, Payload> empty;
+        assert(empty.insert_sorted(batch.begin(), batch.end()) == 21);
+        assert(empty.size() == 21 && empty.shape_stats().height <= 5);
+        assert(empty.shape_stats().consistent() && empty.find(35)->second == Payload("new"));
+
+        // buffered writes: visible before and after the merge, same results as the treemap
+        my::buffered_treemap<int, Payload> b(8);
+        treemap<int, Payload> reference;
+        for (int i = 0; i < 100; i++)
+        {
+            int key = (i * 37) % 50;
+            b.insert(key, Payload(std::to_string(i)));
+            reference.insert(key, Payload(std::to_string(i)));
+            if (i % 3 == 0)
+            {
+                b.insert_or_assign(key + 1, Payload("a" + std::to_string(i)));
+                reference.insert_or_assign(key + 1, Payload("a" + std::to_string(i)));
+            }
+            assert(b.count(key) == 1);
+            assert(*b.find(key) == reference.find(key)->second);
+        }
+        assert(b.buffered() > 0);
+        b[1000] = Payload("x");
+        reference[1000] = Payload("x");
+        assert(b[1000] == Payload("x"));
+        assert(b.find(-1) == nullptr);
+
+        assert(b.size() == reference.size() && b.buffered() == 0);
+        auto rit = reference.begin();
+        for (auto it = b.map().begin(); it != b.map().end(); ++it, ++rit)
+        {
+            assert(it->first == rit->first && it->second == rit->second);
+        }
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "load_text() and load_binary()" << endl;
+
+        char dir_template[] = "/tmp/treemap_loader_XXXXXX";
+        std::string dir = mkdtemp(dir_template);
+
+        // about 3 MB, so three threads get a chunk each; every key occurs twice, the later line wins
+        const int keys = 150000;
+        {
+            std::ofstream out(dir + "/data.csv");
+            out << "key,value\n";
+            for (int line = 0; line < 2 * keys; line++)
+            {
+                out << int(line * 7919LL % keys) << "," << line << (line % 5 == 0 ? "\r\n" : "\n");
+            }
+            out << "\n";
+        }
+        treemap<int, int> m;
+        auto result = my::load_text(dir + "/data.csv", m, {3, ',', true});
+        assert(result.rows == size_t(2 * keys) && m.size() == size_t(keys));
+        assert(m.shape_stats().height <= 18 && m.shape_stats().consistent());
+        for (int line = keys; line < 2 * keys; line++)
+        {
+            assert(m[int(line * 7919LL % keys)] == line);
+        }
+
+        // into a filled map: existing keys are overwritten, others kept
+        {
+            std::ofstream out(dir + "/names.txt");
+            out << "1;one\n" << keys + 1 << ";a;b\n";
+        }
+        my::load_options semicolon;
+        semicolon.separator = ';';
+        treemap<int, std::string> names;
+        names[1] = "x";
+        names[2] = "two";
+        assert(my::load_text(dir + "/names.txt", names, semicolon).rows == 2);
+        assert(names.size() == 3 && names[1] == "one" && names[2] == "two" && names[keys + 1] == "a;b");
+
+        // a malformed line throws and leaves the map as it was
+        {
+            std::ofstream out(dir + "/bad.csv");
+            out << "1,2\nthree,4\n";
+        }
+        bool thrown = false;
+        try
+        {
+            my::load_text(dir + "/bad.csv", m);
+        }
+        catch (const std::runtime_error &)
+        {
+            thrown = true;
+        }
+        assert(thrown && m.size() == size_t(keys) && m[1] != 2);
+
+        // binary: packed int key, double value
+        {
+            std::ofstream out(dir + "/data.bin", std::ios::binary);
+            for (int i = 0; i < 2 * keys; i++)
+            {
+                int key = int(i * 7919LL % keys);
+                double value = i / 2.0;
+                out.write(reinterpret_cast<const char *>(&key), sizeof key);
+                out.write(reinterpret_cast<const char *>(&value), sizeof value);
+            }
+        }
+        treemap<int, double> d;
+        result = my::load_binary(dir + "/data.bin", d, {2});
+        assert(result.rows == size_t(2 * keys) && result.bytes == size_t(2 * keys) * 12);
+        assert(d.size() == size_t(keys) && d[0] == keys / 2.0);
+
+        std::filesystem::remove_all(dir);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "const_iterator, reverse iterators" << endl;
+
+        treemap<int, Payload> m;
+        for (int k : {50, 20, 80, 10, 30, 70, 90})
+        {
+            m[k] = Payload(std::to_string(k));
+        }
+
+        // iterator converts to const_iterator, both compare with each other
+        treemap<int, Payload>::const_iterator cit = m.begin();
+        assert(cit == m.begin() && m.begin() == cit && cit != m.cend());
+        static_assert(std::is_same_v<decltype(*cit), const std::pair<int, Payload> &>);
+
+        const auto &cm = m;
+        int previous = -1;
+        for (const auto &element : cm)
+        {
+            assert(element.first > previous);
+            previous = element.first;
+        }
+        assert(previous == 90);
+
+        std::vector<int> backwards;
+        for (auto rit = m.rbegin(); rit != m.rend(); ++rit)
+        {
+            backwards.push_back(rit->first);
+        }
+        assert((backwards == std::vector<int>{90, 80, 70, 50, 30, 20, 10}));
+        assert(cm.crbegin()->second == Payload("90") && std::prev(cm.crend())->first == 10);
+
+        // post-increment/-decrement and std algorithms
+        auto it = m.find(30);
+        assert((it++)->first == 30 && it->first == 50);
+        assert((it--)->first == 50 && it->first == 30);
+        assert(std::distance(m.cbegin(), m.cend()) == 7);
+        assert(std::find_if(m.rbegin(), m.rend(), [](const auto &e)
+                            { return e.first < 60; })
+                   ->first == 50);
+
+        // --end() still finds the maximum after a rebuild moved the old root down
+        treemap<int, Payload> deep;
+        deep.scapegoat(0.6);
+        for (int k = 0; k < 100; k++)
+        {
+            deep[k] = Payload("x");
+        }
+        assert(deep.rbegin()->first == 99 && (--deep.end())->first == 99);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "static_treemap" << endl;
+
+        // sorted by the compiler, looked up in constant expressions
+        static constexpr auto codes = my::make_static_treemap<int, std::string_view>(
+            {{404, "Not Found"}, {200, "OK"}, {500, "Internal Server Error"}, {301, "Moved Permanently"}});
+        static_assert(codes.size() == 4);
+        static_assert(codes.at(404) == "Not Found");
+        static_assert(codes.count(302) == 0 && codes.find(302) == codes.end());
+        static_assert(codes.begin()->first == 200 && codes.rbegin()->first == 500);
+        static_assert(codes.lower_bound(302)->first == 404);
+
+        // the same at runtime, lower_bound against std::lower_bound over the sorted keys
+        int key = 300;
+        assert(codes.find(key + 1)->second == "Moved Permanently");
+        std::vector<int> sorted_codes{200, 301, 404, 500};
+        for (int k = 0; k < 600; k++)
+        {
+            auto expected = std::lower_bound(sorted_codes.begin(), sorted_codes.end(), k);
+            auto it = codes.lower_bound(k);
+            assert(expected == sorted_codes.end() ? it == codes.end() : it->first == *expected);
+        }
+        int previous = 0;
+        for (const auto &[code, text] : codes)
+        {
+            assert(code > previous && !text.empty());
+            previous = code;
+        }
+
+        // transparent comparison: string_view keys, looked up with a std::string
+        static constexpr auto units = my::make_static_treemap<std::string_view, int, std::less<>>(
+            {{"kb", 1 << 10}, {"mb", 1 << 20}, {"gb", 1 << 30}});
+        std::string unit = "mb";
+        assert(units.at(unit) == 1 << 20 && units.count(std::string("tb")) == 0);
+
+        bool thrown = false;
+        try
+        {
+            units.at("tb");
+        }
+        catch (const std::out_of_range &)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+
+        // duplicate keys: a compile error for constexpr tables, an exception at runtime
+        thrown = false;
+        try
+        {
+            my::make_static_treemap<int, int>({{1, 1}, {2, 2}, {1, 3}});
+        }
+        catch (const std::invalid_argument &)
+        {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "hash_index()" << endl;
+
+        // same answers as without index, through inserts, copy-on-write, copy, swap and clear
+        treemap<int, Payload> m;
+        m[7] = Payload("seven");
+        m.hash_index(true);
+        assert(m.has_hash_index() && m.count(7) == 1);
+        std::map<int, std::string> model{{7, "seven"}};
+        std::mt19937 rng(42);
+        auto snapshot = m.snapshot();
+        for (int i = 0; i < 2000; i++)
+        {
+            int key = int(rng() % 1000);
+            std::string value = std::to_string(i);
+            switch (i % 4)
+            {
+            case 0:
+                m[key] = Payload(value);
+                model[key] = value;
+                break;
+            case 1:
+                m.insert(key, Payload(value));
+                model.emplace(key, value);
+                break;
+            case 2:
+                m.insert_or_assign(key, Payload(value));
+                model[key] = value;
+                break;
+            default:
+                if (i % 400 == 3)
+                {
+                    // new snapshot: the following writes copy the nodes they reach
+                    snapshot = m.snapshot();
+                }
+            }
+        }
+        std::vector<std::pair<int, Payload>> batch{{1001, Payload("a")}, {1002, Payload("b")}};
+        m.insert_or_assign_sorted(batch.begin(), batch.end());
+        model[1001] = "a";
+        model[1002] = "b";
+        for (int key = -1; key < 1005; key++)
+        {
+            auto it = model.find(key);
+            assert(m.count(key) == (it != model.end() ? 1u : 0u));
+            assert(it == model.end() ? m.find(key) == m.end() : m.find(key)->second == Payload(it->second));
+        }
+        treemap<int, Payload> plain = m;
+        plain.hash_index(false);
+        assert(m.shape_stats().bytes >= plain.shape_stats().bytes + 16 * m.size());
+
+        treemap<int, Payload> copy = m;
+        assert(copy.has_hash_index() && copy.find(1001)->second == Payload("a"));
+        copy[1001] = Payload("changed");
+        assert(m.find(1001)->second == Payload("a"));
+
+        treemap<int, Payload> other;
+        ::swap(m, other);
+        assert(!m.has_hash_index() && other.has_hash_index() && other.count(1002) == 1);
+        other.clear();
+        assert(other.count(1002) == 0 && other.find(7) == other.end());
+        other[5] = Payload("five");
+        assert(other.find(5)->second == Payload("five"));
+        other.hash_index(false);
+        assert(!other.has_hash_index() && other.count(5) == 1);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+    {
+        cout << "node_hash_index: erase with colliding hashes" << endl;
+
+        // hash k % 7: long probe runs, erase must keep every remaining entry reachable
+        std::vector<int> nodes(1000);
+        my::node_hash_index<int> index;
+        for (int k = 0; k < 1000; k++)
+        {
+            nodes[k] = k;
+            index.insert(size_t(k % 7), &nodes[k]);
+        }
+        for (int k = 0; k < 1000; k += 2)
+        {
+            index.erase(size_t(k % 7), &nodes[k]);
+        }
+        assert(index.size() == 500);
+        for (int k = 0; k < 1000; k++)
+        {
+            int *found = index.find(size_t(k % 7), [&](int *n)
+                                    { return *n == k; });
+            assert(k % 2 == 0 ? found == nullptr : found == &nodes[k]);
+        }
+    }
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "erase()" << endl;
+
+        // random inserts and erases against std::map, with cache, index and snapshots
+        for (int variant = 0; variant < 3; variant++)
+        {
+            treemap<int, Payload> m;
+            if (variant == 1)
+            {
+                m.front_cache(64);
+                m.hash_index(true);
+            }
+            std::map<int, Payload> model;
+            std::mt19937 rng(7 + variant);
+            treemap<int, Payload>::snapshot_type snapshot = m.snapshot();
+            std::map<int, Payload> snapshot_model;
+            for (int i = 0; i < 3000; i++)
+            {
+                int key = int(rng() % 300);
+                if (rng() % 2 == 0)
+                {
+                    m[key] = Payload(std::to_string(i));
+                    model[key] = Payload(std::to_string(i));
+                }
+                else
+                {
+                    assert(m.erase(key) == model.erase(key));
+                }
+                assert(m.count(key) == model.count(key));
+                if (variant == 2 && i % 500 == 0)
+                {
+                    snapshot = m.snapshot();
+                    snapshot_model = model;
+                }
+            }
+            assert(m.size() == model.size() && m.shape_stats().consistent());
+            auto expected = model.begin();
+            for (auto it = m.begin(); it != m.end(); ++it, ++expected)
+            {
+                assert(it->first == expected->first && it->second == expected->second);
+            }
+            assert(expected == model.end());
+            if (variant == 2)
+            {
+                // the snapshot still shows its point in time
+                assert(snapshot.size() == snapshot_model.size());
+                auto sit = snapshot.begin();
+                for (auto &[key, value] : snapshot_model)
+                {
+                    assert(sit->first == key && sit->second == value);
+                    ++sit;
+                }
+            }
+
+            // erase(iterator) returns the next element, every second one here
+            for (auto it = m.begin(); it != m.end();)
+            {
+                it = m.erase(it);
+                if (it != m.end())
+                {
+                    ++it;
+                }
+            }
+            assert(m.size() == model.size() / 2 && m.shape_stats().consistent());
+            while (m.size() > 0)
+            {
+                m.erase(m.begin());
+            }
+            assert(m.begin() == m.end() && m.count(0) == 0);
+        }
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "cache_treemap: expiry and eviction" << endl;
+        using namespace std::chrono_literals;
+        using cache = my::cache_treemap<int, Payload, std::less<int>, manual_clock>;
+
+        // lru: lookups keep an entry, the least recently used one goes
+        {
+            my::cache_options options;
+            options.max_size = 3;
+            cache c(options);
+            c.insert_or_assign(1, Payload("one"));
+            c.insert_or_assign(2, Payload("two"));
+            c.insert_or_assign(3, Payload("three"));
+            assert(c.find(1) != nullptr);
+            c.insert_or_assign(4, Payload("four"));
+            assert(c.size() == 3 && c.count(2) == 0 && c.count(1) == 1 && c.evictions() == 1);
+            c[5] = Payload("five");
+            assert(c.count(3) == 0 && c.count(1) == 1);
+            // overwriting counts as a use too
+            c.insert_or_assign(1, Payload("uno"));
+            c.insert_or_assign(6, Payload("six"));
+            assert(c.count(4) == 0 && *c.find(1) == Payload("uno"));
+            assert(Payload::alive_count() == 3);
+        }
+        assert(Payload::alive_count() == 0);
+
+        // fifo: lookups change nothing
+        {
+            my::cache_options options;
+            options.max_size = 2;
+            options.eviction = my::cache_eviction::fifo;
+            options.hash_index = true;
+            cache c(options);
+            c.insert_or_assign(1, Payload("one"));
+            c.insert_or_assign(2, Payload("two"));
+            assert(c.find(1) != nullptr);
+            c.insert_or_assign(3, Payload("three"));
+            assert(c.count(1) == 0 && c.count(2) == 1 && c.count(3) == 1);
+        }
+
+        // ttl: invisible once expired, removed by lookups, writes and expire()
+        {
+            manual_clock::ticks = 0;
+            cache c;
+            c.insert_or_assign(1, Payload("one"), 10ns);
+            c.insert_or_assign(2, Payload("two"), 20ns);
+            c.insert_or_assign(3, Payload("three"), 30ns);
+            c.insert_or_assign(4, Payload("four"));
+            // a new ttl replaces the old one
+            c.insert_or_assign(3, Payload("three"), 5ns);
+            manual_clock::ticks = 15;
+            assert(c.count(1) == 0 && c.count(2) == 1 && c.count(3) == 0 && c.size() == 4);
+            vector<int> keys;
+            c.for_each([&](int key, const Payload &)
+                       { keys.push_back(key); });
+            assert((keys == vector<int>{2, 4}));
+            assert(c.find(1) == nullptr && c.size() == 3 && c.expirations() == 1);
+            c.insert_or_assign(5, Payload("five"));
+            assert(c.size() == 3 && c.expirations() == 2);
+            manual_clock::ticks = 100;
+            assert(c.expire() == 1 && c.size() == 2 && c.expire() == 0);
+            assert(c.count(4) == 1 && c.count(5) == 1 && c.evictions() == 0);
+            // writing without ttl makes an entry permanent
+            c.insert_or_assign(6, Payload("six"), 1ns);
+            c.insert_or_assign(6, Payload("six"));
+            manual_clock::ticks = 200;
+            assert(c.count(6) == 1 && c.expire() == 0);
+        }
+        assert(Payload::alive_count() == 0);
+
+        // sustained load with random ttls and a byte budget: memory stays flat
+        {
+            manual_clock::ticks = 0;
+            my::cache_options options;
+            options.max_bytes = 50000;
+            cache c(options, [](int, const Payload &p)
+                    { return p.content.size(); });
+            std::mt19937 rng(43);
+            std::map<int, manual_clock::time_point> expires;
+            for (int i = 0; i < 20000; i++)
+            {
+                manual_clock::ticks++;
+                int key = int(rng() % 5000);
+                switch (rng() % 4)
+                {
+                case 0:
+                    c.insert_or_assign(key, Payload(std::string(rng() % 40, 'x')));
+                    break;
+                case 1:
+                    c.insert_or_assign(key, Payload("ttl"), std::chrono::nanoseconds(rng() % 100));
+                    break;
+                case 2:
+                    c.erase(key);
+                    break;
+                default:
+                    c.find(key);
+                }
+                assert(c.bytes() <= options.max_bytes);
+                assert(size_t(Payload::alive_count()) == c.size());
+            }
+            assert(c.evictions() > 0 && c.expirations() > 0);
+            size_t bytes = 0;
+            c.for_each([&](int, const Payload &p)
+                       { bytes += p.content.size(); });
+            assert(bytes < c.bytes());
+            c.clear();
+            assert(c.size() == 0 && c.bytes() == 0 && c.count(1) == 0);
+        }
+        assert(Payload::alive_count() == 0);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "interval_treemap: overlap and stabbing queries" << endl;
+        using window = my::interval<int>;
+
+        // random intervals against a brute-force scan, with inserts and erases mixed in
+        my::interval_treemap<int, Payload> m;
+        std::map<pair<int, int>, Payload> model;
+        std::mt19937 rng(44);
+        for (int i = 0; i < 4000; i++)
+        {
+            int start = int(rng() % 1000);
+            window w{start, start + int(rng() % 50)};
+            if (rng() % 4 == 0)
+            {
+                assert(m.erase(w) == model.erase({w.start, w.end}));
+            }
+            else
+            {
+                m.insert_or_assign(w, Payload(std::to_string(i)));
+                model[{w.start, w.end}] = Payload(std::to_string(i));
+            }
+        }
+        assert(m.size() == model.size() && size_t(Payload::alive_count()) == 2 * model.size());
+        for (int q = 0; q < 300; q++)
+        {
+            int a = int(rng() % 1100) - 50, b = a + 1 + int(rng() % 30);
+            vector<pair<int, int>> expected, got;
+            for (auto &[w, value] : model)
+            {
+                if (w.first < w.second && w.first < b && a < w.second)
+                {
+                    expected.push_back(w);
+                }
+            }
+            m.overlapping(a, b, [&](const window &w, const Payload &value)
+                          { assert((value == model[{w.start, w.end}])); got.push_back({w.start, w.end}); });
+            assert(got == expected && m.count_overlapping(a, b) == expected.size());
+
+            size_t stabbed = 0;
+            for (auto &[w, value] : model)
+            {
+                stabbed += w.first <= a && a < w.second ? 1 : 0;
+            }
+            assert(m.count_containing(a) == stabbed);
+        }
+        assert(m.count_overlapping(5, 5) == 0);
+        vector<pair<int, int>> all;
+        m.for_each([&](const window &w, const Payload &)
+                   { all.push_back({w.start, w.end}); });
+        assert(all.size() == model.size() && std::is_sorted(all.begin(), all.end()));
+        assert(m.find(window{all[0].first, all[0].second}) != nullptr && m.count(window{-5, 5}) == 0);
+        m[window{-5, 5}] = Payload("new");
+        assert(m.count_containing(-5) == 1 && m.erase(window{-5, 5}) == 1);
+        model.clear();
+        m.clear();
+        assert(Payload::alive_count() == 0);
+
+        // time windows arriving in order stay a tree of logarithmic height
+        my::interval_treemap<int, int> log;
+        for (int t = 0; t < 100000; t++)
+        {
+            log.insert(window{t, t + 10}, t);
+        }
+        assert(log.height() <= 2 * std::bit_width(log.size()) && log.count_containing(500) == 10);
+        for (int t = 0; t < 90000; t++)
+        {
+            log.erase(window{t, t + 10});
+        }
+        assert(log.size() == 10000 && log.height() <= 2 * std::bit_width(log.size()));
+        assert(log.count_overlapping(0, 90005) == 5 && log.count_containing(99999) == 10);
+
+        // empty and inverted intervals can be stored, but overlap and contain nothing
+        my::interval_treemap<int, int> odd;
+        odd.insert(window{5, 5}, 1);
+        odd.insert(window{7, 3}, 2);
+        odd.insert(window{4, 6}, 3);
+        assert(odd.size() == 3 && odd.count(window{7, 3}) == 1);
+        assert(odd.count_overlapping(4, 6) == 1 && odd.count_overlapping(0, 10) == 1);
+        assert(odd.count_overlapping(6, 8) == 0 && odd.count_overlapping(2, 4) == 0);
+        for (int t = 0; t < 10; t++)
+        {
+            assert(odd.count_containing(t) == (t == 4 || t == 5 ? 1u : 0u));
+        }
+        odd.overlapping(0, 10, [](const window &w, int v)
+                        { assert(w == (window{4, 6}) && v == 3); });
+
+        // bulk load of a sorted stream
+        vector<pair<window, int>> stream;
+        for (int t = 0; t < 1000; t++)
+        {
+            stream.push_back({window{t * 10, t * 10 + 25}, t});
+        }
+        my::interval_treemap<int, int> loaded;
+        assert(loaded.insert_sorted(stream.begin(), stream.end()) == 1000);
+        assert(loaded.height() == size_t(std::bit_width(1000u)) && loaded.count_containing(100) == 3);
+        std::swap(stream[3], stream[4]);
+        bool thrown = false;
+        try
+        {
+            loaded.insert_sorted(stream.begin(), stream.end());
+        }
+        catch (const std::invalid_argument &)
+        {
+            thrown = true;
+        }
+        assert(thrown && loaded.size() == 1000);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "co_find(), find_batch(), interleave()" << endl;
+
+        treemap<int, Payload> m;
+        std::mt19937 rng(45);
+        vector<int> keys;
+        for (int i = 0; i < 2000; i++)
+        {
+            int key = int(rng() % 10000);
+            m[key] = Payload(std::to_string(key));
+            keys.push_back(key + int(rng() % 2)); // about half of them miss
+        }
+
+        // one coroutine on its own, step by step
+        auto task = m.co_find(keys[0]);
+        size_t steps = 0;
+        while (!task.done())
+        {
+            task.resume();
+            steps++;
+        }
+        assert(task.result() == m.find(keys[0]) && steps >= 2);
+        assert(m.co_find(-1).get() == m.end());
+
+        // batches of any width give the same answers as find()
+        for (size_t width : {size_t(1), size_t(7), size_t(16), size_t(5000)})
+        {
+            vector<treemap<int, Payload>::iterator> found;
+            m.find_batch(keys.begin(), keys.end(), std::back_inserter(found), width);
+            assert(found.size() == keys.size());
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                assert(found[i] == m.find(keys[i]));
+            }
+        }
+
+        // the same through the hash index, and with the scheduler used directly
+        m.hash_index(true);
+        size_t hits = 0;
+        my::interleave(
+            keys.size(), [&](size_t i)
+            { return m.co_find(keys[i]); },
+            [&](size_t i, treemap<int, Payload>::iterator it)
+            { assert(it == m.find(keys[i])); hits += it != m.end() ? 1 : 0; });
+        assert(hits == size_t(std::count_if(keys.begin(), keys.end(), [&](int k)
+                                            { return m.count(k) == 1; })));
+        vector<treemap<int, Payload>::iterator> none;
+        m.find_batch(keys.end(), keys.end(), std::back_inserter(none));
+        assert(none.empty());
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "from_unsorted(), parallel stable_sort" << endl;
+
+        // duplicates, sizes around the thread thresholds, both duplicate rules
+        std::mt19937 rng(46);
+        for (size_t n : {size_t(0), size_t(1), size_t(1000), size_t(300000)})
+        {
+            vector<pair<int, int>> input(n);
+            for (size_t i = 0; i < n; i++)
+            {
+                input[i] = {int(rng() % (n / 2 + 1)), int(i)};
+            }
+            std::map<int, int> last, first;
+            auto same = [](const auto &a, const auto &b)
+            { return a.first == b.first && a.second == b.second; };
+            for (auto &[key, value] : input)
+            {
+                last[key] = value;
+                first.insert({key, value});
+            }
+            for (unsigned threads : {1u, 3u, 8u})
+            {
+                my::build_policy policy;
+                policy.threads = threads;
+                auto m = treemap<int, int>::from_unsorted(input, policy);
+                policy.duplicates = my::duplicate_keys::first_wins;
+                auto f = treemap<int, int>::from_unsorted(input, policy);
+                assert(m.size() == last.size() && f.size() == first.size());
+                assert(std::equal(m.begin(), m.end(), last.begin(), last.end(), same));
+                assert(std::equal(f.begin(), f.end(), first.begin(), first.end(), same));
+                auto shape = m.shape_stats();
+                assert(shape.consistent() && shape.height == size_t(std::bit_width(m.size())));
+            }
+        }
+
+        // payloads: moved out of an rvalue vector, nothing leaks; descending order by comparator
+        {
+            vector<pair<int, Payload>> input;
+            for (int i = 0; i < 100; i++)
+            {
+                input.push_back({i % 10, Payload(std::to_string(i))});
+            }
+            auto m = treemap<int, Payload, std::greater<int>>::from_unsorted(std::move(input));
+            assert(m.size() == 10 && Payload::alive_count() == 10 && input.empty());
+            assert(m.begin()->first == 9 && m.begin()->second == Payload("99"));
+            treemap<int, Payload, std::greater<int>> moved(std::move(m));
+            assert(moved.size() == 10 && m.size() == 0 && m.begin() == m.end());
+        }
+
+        // string keys: elements kept earlier are moved out, duplicates must still be recognized
+        {
+            vector<pair<string, int>> input{{"a", 0}, {"b", 3}, {"a", 1}, {"c", 5}, {"b", 4}};
+            for (unsigned threads : {1u, 3u})
+            {
+                my::build_policy policy;
+                policy.threads = threads;
+                auto last = treemap<string, int>::from_unsorted(input, policy);
+                policy.duplicates = my::duplicate_keys::first_wins;
+                auto first = treemap<string, int>::from_unsorted(input, policy);
+                assert(last.size() == 3 && last["a"] == 1 && last["b"] == 4 && last["c"] == 5);
+                assert(first.size() == 3 && first["a"] == 0 && first["b"] == 3 && first["c"] == 5);
+            }
+        }
+
+        // the sort alone: stable across chunk and piece boundaries
+        vector<pair<int, int>> v(200000);
+        for (size_t i = 0; i < v.size(); i++)
+        {
+            v[i] = {int(rng() % 100), int(i)};
+        }
+        auto by_key = [](const pair<int, int> &a, const pair<int, int> &b)
+        { return a.first < b.first; };
+        auto expected = v;
+        std::stable_sort(expected.begin(), expected.end(), by_key);
+        for (unsigned threads : {2u, 5u, 16u})
+        {
+            auto sorted = v;
+            my::parallel_detail::stable_sort(sorted, by_key, threads);
+            assert(sorted == expected);
+        }
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+
+    {
+        cout << "node_resource(), huge_page_resource, numa_replicas" << endl;
+
+        // every node of every path goes through the resource and comes back to it
+        counting_resource counting;
+        {
+            treemap<int, Payload> m;
+            m.node_resource(&counting);
+            for (int i = 0; i < 100; i++)
+            {
+                m[(i * 37) % 100] = Payload(std::to_string(i));
+            }
+            assert(counting.live == 100);
+            auto snapshot = m.snapshot();
+            m[1000] = Payload("copied path");
+            m.erase(50);
+            assert(counting.live > 101);
+            treemap<int, Payload> copy = m;
+            assert(copy.node_resource() == &counting);
+            vector<pair<int, Payload>> batch{{2000, Payload("a")}, {2001, Payload("b")}};
+            copy.insert_sorted(batch.begin(), batch.end());
+            assert(copy.size() == 102);
+        }
+        assert(counting.live == 0 && Payload::alive_count() == 0);
+        {
+            my::build_policy policy;
+            policy.resource = &counting;
+            vector<pair<int, int>> input{{3, 3}, {1, 1}, {2, 2}};
+            auto m = treemap<int, int>::from_unsorted(input, policy);
+            assert(counting.live == 3 && m.node_resource() == &counting);
+            m[4] = 4;
+            assert(counting.live == 4);
+        }
+        assert(counting.live == 0);
+
+        // huge pages: blocks recycled per size class, chunks aligned to 2 MB
+        {
+            my::huge_page_options options;
+            options.chunk_bytes = 1; // rounded up to one huge page
+            my::huge_page_resource pages(options);
+            {
+                treemap<int, Payload> m;
+                m.node_resource(&pages);
+                std::mt19937 rng(47);
+                std::map<int, Payload> model;
+                for (int i = 0; i < 50000; i++)
+                {
+                    int key = int(rng() % 20000);
+                    if (rng() % 3 == 0)
+                    {
+                        assert(m.erase(key) == model.erase(key));
+                    }
+                    else
+                    {
+                        m[key] = Payload("x");
+                        model[key] = Payload("x");
+                    }
+                }
+                assert(m.size() == model.size() && m.shape_stats().consistent());
+                assert(pages.mapped_bytes() % my::huge_page_resource::huge_page == 0);
+                // freed nodes are reused: far less than one chunk per 2 MB of inserts
+                assert(pages.mapped_bytes() <= 2 * 2 * m.shape_stats().bytes);
+                assert(reinterpret_cast<uintptr_t>(&*m.begin()) / my::huge_page_resource::huge_page != 0);
+                // large blocks go upstream
+                void *big = pages.allocate(1 << 20);
+                pages.deallocate(big, 1 << 20);
+            }
+            assert(Payload::alive_count() == 0);
+        }
+
+        // replicas: one per NUMA node (on most test machines just one), all equal to the source
+        {
+            treemap<int, int> source;
+            for (int i = 0; i < 1000; i++)
+            {
+                source[(i * 7919) % 1000] = i;
+            }
+            my::numa_replicas<int, int> replicas(source, 2);
+            assert(replicas.replica_count() == 2 && my::numa_node_count() >= 1);
+            for (unsigned r = 0; r < 2; r++)
+            {
+                auto &replica = replicas.replica(r);
+                assert(replica.size() == 1000 && replica.shape_stats().height == size_t(std::bit_width(1000u)));
+                assert(std::equal(replica.cbegin(), replica.cend(), source.cbegin(), source.cend()));
+            }
+            replicas.update([](treemap<int, int> &replica)
+                            { replica[5000] = 1; });
+            assert(replicas.local().count(5000) == 1 && replicas.local().size() == 1001);
+        }
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+    {
+        cout << "diff() and apply() ..." << endl;
+        auto same = [](const auto &a, const auto &b)
+        { return a.first == b.first && a.second == b.second; };
+        {
+            // replica and primary start equal; the primary keeps a snapshot of what was shipped
+            treemap<int, Payload> primary;
+            for (int i = 0; i < 20000; i++)
+            {
+                primary[(i * 7919) % 20000] = Payload(std::to_string(i));
+            }
+            treemap<int, Payload> replica(primary);
+            auto shipped = primary.snapshot();
+            assert(my::diff(shipped, primary).empty());
+
+            primary[20001] = Payload("new");           // inserted
+            primary[17] = Payload("changed");          // changed
+            primary.insert_or_assign(18, primary[18]); // same value: no change
+            primary.erase(100);                        // removed
+            primary.erase(99999);                      // not there
+            auto delta = my::diff(shipped, primary);
+            assert(delta.size() == 3 && delta.inserted == 1 && delta.removed == std::vector<int>{100});
+            assert(delta.upserts[0].first == 17 && delta.upserts[1].first == 20001);
+            // shared subtrees are skipped: a few paths, not 20000 nodes
+            assert(delta.nodes_visited < 400);
+
+            replica.apply(delta);
+            assert(std::equal(replica.cbegin(), replica.cend(), primary.cbegin(), primary.cend(), same));
+
+            // a deep copy shares nothing: the same result, element by element
+            treemap<int, Payload> copy(primary);
+            auto full = my::diff(replica, copy);
+            assert(full.empty() && full.nodes_visited >= 2 * copy.size());
+        }
+
+        // random batches of writes against a model
+        {
+            std::mt19937 rng(48);
+            treemap<int, int> m;
+            for (int round = 0; round < 50; round++)
+            {
+                auto before = m.snapshot();
+                std::map<int, int> model(m.begin(), m.end());
+                treemap<int, int> behind(m);
+                for (int i = 0; i < 200; i++)
+                {
+                    int key = int(rng() % 1000);
+                    if (rng() % 3 == 0)
+                    {
+                        m.erase(key);
+                        model.erase(key);
+                    }
+                    else
+                    {
+                        m[key] = int(rng() % 4);
+                        model[key] = m[key];
+                    }
+                }
+                auto delta = my::diff(before, m);
+                assert(std::is_sorted(delta.removed.begin(), delta.removed.end()));
+                assert(std::is_sorted(delta.upserts.begin(), delta.upserts.end()));
+                behind.apply(delta);
+                assert(behind.size() == model.size() && std::equal(behind.begin(), behind.end(), model.begin(), model.end(), same));
+                assert(my::diff(behind, m).empty());
+            }
+        }
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+    {
+        cout << "copies, moves and node allocations per operation" << endl;
+        // the numbers are the minimum each operation needs through its interface (const T &: one
+        // copy per new value); do not raise them, remove the extra copy instead
+        counting_resource counting;
+        {
+            const Payload p("p");
+            vector<pair<int, Payload>> sorted;
+            for (int key = 10; key <= 70; key += 10)
+            {
+                sorted.emplace_back(key, p);
+            }
+            treemap<int, Payload> m;
+            m.node_resource(&counting);
+            {
+                payload_counts c{counting};
+                m.insert_sorted(sorted.begin(), sorted.end()); // balanced, 40 at the root
+                assert(c.are(7, 0, 0, 0, 0, 7));
+            }
+            {
+                payload_counts c{counting};
+                m.insert(75, p);
+                m.insert_or_assign(76, p);
+                assert(c.are(2, 0, 0, 0, 0, 2));
+            }
+            {
+                payload_counts c{counting};
+                m.insert(75, p);
+                m.insert_or_assign(75, p);
+                assert(c.are(0, 0, 1, 0, 0, 0));
+            }
+            {
+                // the default value is constructed in the new node
+                payload_counts c{counting};
+                m[77];
+                assert(c.are(0, 0, 0, 0, 0, 1));
+            }
+            {
+                payload_counts c{counting};
+                m[77] = Payload("moved in");
+                m[77] = p;
+                m.find(77);
+                m.count(78);
+                assert(c.are(0, 0, 1, 1, 1, 0));
+            }
+            {
+                payload_counts c{counting};
+                treemap<int, Payload> copy(m);
+                assert(c.are(10, 0, 0, 0, 0, 10));
+                copy = m;
+                assert(c.are(20, 0, 0, 0, 10, 20));
+                treemap<int, Payload> moved(std::move(copy));
+                copy = std::move(moved);
+                assert(c.are(20, 0, 0, 0, 10, 20));
+                copy.clear();
+                assert(c.are(20, 0, 0, 0, 20, 20));
+            }
+            {
+                payload_counts c{counting};
+                m.erase(77);
+                m.erase(76);
+                m.erase(75);
+                assert(c.are(0, 0, 0, 0, 3, 0));
+            }
+            {
+                // under a snapshot a write copies the path to the node: 40, 60, 70
+                auto snapshot = m.snapshot();
+                payload_counts c{counting};
+                m[70] = p;
+                assert(c.are(3, 0, 1, 0, 0, 3));
+            }
+        }
+        assert(counting.live == 0);
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+#if 1
+    {
+        cout << "frozen_treemap" << endl;
+        {
+            // timestamps: steady rate with jitter, a few long gaps, negative and extreme keys
+            std::mt19937_64 rng(50);
+            treemap<int64_t, int> m;
+            int64_t t = -1000000;
+            for (int i = 0; i < 10000; i++)
+            {
+                t += 1 + int64_t(rng() % 16);
+                if (i % 1500 == 0)
+                {
+                    t += int64_t(1) << 40;
+                }
+                m[t] = i;
+            }
+            m[std::numeric_limits<int64_t>::min()] = -1;
+            m[std::numeric_limits<int64_t>::max()] = -2;
+
+            my::frozen_treemap<int64_t, int> frozen(m);
+            assert(frozen.size() == m.size() && frozen.count(std::numeric_limits<int64_t>::min()) == 1);
+            for (auto &[key, value] : m)
+            {
+                assert(frozen.find(key) != nullptr && *frozen.find(key) == value && frozen.at(key) == value);
+                assert(key == std::numeric_limits<int64_t>::max() || (frozen.count(key + 1) == m.count(key + 1)));
+            }
+            assert(frozen.find(-1000000) == nullptr && frozen.count(std::numeric_limits<int64_t>::max() - 1) == 0);
+            bool thrown = false;
+            try
+            {
+                frozen.at(0);
+            }
+            catch (const std::out_of_range &)
+            {
+                thrown = true;
+            }
+            assert(thrown);
+
+            vector<pair<int64_t, int>> all;
+            frozen.for_each([&](int64_t key, int value)
+                            { all.emplace_back(key, value); });
+            assert(std::equal(all.begin(), all.end(), m.cbegin(), m.cend(), [](const auto &a, const auto &b)
+                              { return a.first == b.first && a.second == b.second; }));
+            // a range across block boundaries and one with no keys
+            auto from = std::next(m.cbegin(), 100), to = std::next(m.cbegin(), 300);
+            size_t in_range = 0;
+            frozen.for_each(from->first, to->first, [&](int64_t key, int)
+                            { assert(key >= from->first && key < to->first); in_range++; });
+            assert(in_range == 200);
+            frozen.for_each(to->first, from->first, [&](int64_t, int)
+                            { assert(false); });
+
+            // deltas below 16 take 4 bits: a key and its value in about 5 bytes
+            assert(frozen.bytes() < 6 * frozen.size() && frozen.bytes() * 10 < m.shape_stats().bytes);
+        }
+
+        // small keys, empty maps, unsorted input
+        {
+            vector<pair<int8_t, Payload>> small{{-128, Payload("a")}, {-1, Payload("b")}, {0, Payload("c")}, {127, Payload("d")}};
+            my::frozen_treemap<int8_t, Payload> frozen(small.begin(), small.end());
+            assert(frozen.at(-128).content == "a" && frozen.at(127).content == "d" && frozen.count(1) == 0);
+
+            my::frozen_treemap<uint32_t, int> empty(treemap<uint32_t, int>{});
+            assert(empty.empty() && empty.find(0) == nullptr);
+            empty.for_each([](uint32_t, int)
+                           { assert(false); });
+
+            vector<pair<int, int>> unsorted{{1, 1}, {3, 3}, {2, 2}};
+            bool thrown = false;
+            try
+            {
+                my::frozen_treemap<int, int> bad(unsorted.begin(), unsorted.end());
+            }
+            catch (const std::invalid_argument &)
+            {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+    }
+    assert(Payload::alive_count() == 0);
+    cout << "done." << endl;
+
+#endif
+
+}
@@ -8,31 +8,70 @@
 #include <iostream>
 #include <utility>
 #include <tuple>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <type_traits>
+#include <vector>
 #include "treemap_node.h"
 #include "treemap_iterator.h"
+#include "treemap_snapshot.h"
+#include "treemap_diff.h"
+#include "bloom_filter.h"
+#include "hash_index.h"
+#include "treemap_coro.h"
+#include "treemap_parallel.h"
+#include "treemap_stats.h"
 
 // forward declarations
 
 namespace my
 {
-    template <typename K, typename T>
+    template <typename K, typename T, typename Compare = std::less<K>>
     class treemap;
 }
 
-template <typename KK, typename TT>
-void swap(my::treemap<KK, TT> &lhs, my::treemap<KK, TT> &rhs);
+template <typename KK, typename TT, typename CC>
+void swap(my::treemap<KK, TT, CC> &lhs, my::treemap<KK, TT, CC> &rhs);
 
 namespace my
 {
 
+    // can std::hash<K> be used for K?
+    template <typename K, typename = void>
+    struct is_hashable : std::false_type
+    {
+    };
+
+    template <typename K>
+    struct is_hashable<K, std::void_t<decltype(std::hash<K>{}(std::declval<const K &>()))>> : std::true_type
+    {
+    };
+
     /*
-     * class treemap<K,T>
+     * class treemap<K,T,Compare>
      * represents an associative container (dictionary) with unique keys
      * implemented by a binary search tree
-     * - no balancing, no remove/erase operations
-     * - no separate comparison operators, relies on K::operator==(), K::operator<(), etc.
+     * - no balancing (unless scapegoat rebuilding is switched on)
+     * - keys are ordered by Compare (default std::less<K>), one comparison per visited node
+     * - if Compare::is_transparent exists, find/count/lower_bound accept any key type
+     *   comparable with K (e.g. std::string_view for std::string keys, no temporaries)
+     * - optional front cache for skewed lookups: a small direct-mapped table of recently found
+     *   nodes, consulted before descending the tree
+     * - optional bloom filter for miss-heavy lookups: most absent keys are rejected after
+     *   looking at a single cache line, without descending the tree
+     * - optional hash index for exact-key lookups: O(1) find/count/operator[], the tree still
+     *   provides the order
+     * - optional scapegoat rebuilding: a subtree that got too deep is rebuilt perfectly balanced,
+     *   O(log n) amortized without any balance data in the nodes
+     * - snapshot(): O(1) read-only view sharing all nodes, later writes copy the paths they touch
+     * - optional hot-path counters (comparisons, visited nodes, allocations),
+     *   compiled in with -DTREEMAP_STATS, see stats()
      */
-    template <typename K, typename T>
+    template <typename K, typename T, typename Compare>
     class treemap
     {
 
@@ -41,18 +80,56 @@ namespace my
         using key_type = K;
         using mapped_type = T;
         using value_type = std::pair<K, T>;
+        using key_compare = Compare;
         using iterator = my::treemap_iterator<K, T>;
+        using const_iterator = my::treemap_iterator<K, T, true>;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+        using snapshot_type = my::treemap_snapshot<K, T, Compare>;
 
     public:
         // construct empty map
 
         treemap()
-            : root_(), count_(0)
+            : root_(), count_(0), comp_()
+        {
+        }
+
+        // construct empty map using a specific comparison object
+        explicit treemap(const Compare &comp)
+            : root_(), count_(0), comp_(comp)
         {
         }
 
         // copyconstructor
-        treemap(const treemap &other) : root_(copy_recursive(other.root_)), count_(other.count_) {}
+        treemap(const treemap &other)
+            : root_(copy_recursive(other.root_, other.node_resource_)), count_(other.count_), comp_(other.comp_),
+              front_cache_(other.front_cache_.size()),
+              bloom_(other.bloom_ ? std::make_unique<blocked_bloom_filter>(*other.bloom_) : nullptr),
+              bloom_stale_(other.bloom_stale_),
+              scapegoat_alpha_(other.scapegoat_alpha_), node_resource_(other.node_resource_)
+        {
+            TREEMAP_COUNT(&stats_, node_allocations, count_);
+            if (other.hash_index_)
+            {
+                hash_index(true);
+            }
+        }
+
+        // move constructor, other is left empty
+        treemap(treemap &&other) noexcept
+            : treemap(other.comp_)
+        {
+            swap(*this, other);
+        }
+
+        // map of all (key, value) pairs of an unsorted range (e.g. a std::vector<std::pair<K, T>>)
+        // the pairs are sorted on policy.threads threads (stable, so duplicate keys keep their
+        // input order and policy.duplicates picks the first or last value), then the tree is
+        // built perfectly balanced, its subtrees on separate threads. a range passed as an rvalue
+        // std::vector<std::pair<K, T>> is sorted in place instead of copied
+        template <typename Range>
+        static treemap from_unsorted(Range &&range, const build_policy &policy = build_policy(), const Compare &comp = Compare());
 
         // number of keys in map
         size_t size() const;
@@ -60,6 +137,8 @@ namespace my
         // how often is the element contained in the map?
         // (for this type of container, can only return 0 or 1)
         size_t count(const K &) const;
+        template <typename KK, typename C = Compare, typename = typename C::is_transparent>
+        size_t count(const KK &) const;
 
         // random read/write access to value by key
         T &operator[](const K &);
@@ -68,20 +147,145 @@ namespace my
         void clear();
 
         // used for copy&move - declared in global namespace, not in my::
-        template <typename KK, typename TT>
-        friend void ::swap(treemap<KK, TT> &, treemap<KK, TT> &);
+        template <typename KK, typename TT, typename CC>
+        friend void ::swap(treemap<KK, TT, CC> &, treemap<KK, TT, CC> &);
 
         // declaration assignment operator
-        treemap<K, T> &operator=(treemap other);
+        treemap<K, T, Compare> &operator=(treemap other);
+
+        // the comparison object used to order the keys
+        key_compare key_comp() const { return comp_; }
+
+        // switch the front cache on (slots > 0, rounded up to a power of two) or off (slots == 0)
+        // find/count/operator[] by K first look at the slot hash(key) selects, a hit skips the descent
+        // into the tree. each slot counts its hits, a found node only replaces the entry once misses
+        // on that slot have used up those hits, so cold keys do not push out hot ones.
+        // the cache only holds node addresses, it is reset by clear() and stays valid when inserting.
+        // lookups then write to the cache, so they must not run concurrently, even on a const treemap.
+        void front_cache(size_t slots);
+
+        // number of front cache slots, 0 if switched off
+        size_t front_cache_size() const { return front_cache_.size(); }
+
+        // allocate new nodes from resource (nullptr: make_shared, the default), e.g. a
+        // huge_page_resource (node_memory.h); nodes that exist stay where they are, and each node
+        // is freed through the resource it came from. the resource must outlive the map, its
+        // copies and its snapshots.
+        void node_resource(std::pmr::memory_resource *resource) { node_resource_ = resource; }
+        std::pmr::memory_resource *node_resource() const { return node_resource_; }
+
+        // switch the bloom filter on (expected_keys > 0) or off (expected_keys == 0)
+        // find/count/operator[] by K check the filter first and return "not found" right away
+        // if it rules the key out. the filter is filled on insert, reset by clear() and rebuilt
+        // twice as large when the map outgrows it. 10 bits per key give about 1% false positives.
+        // lookups then update the filter's counters, so they must not run concurrently.
+        void bloom_filter(size_t expected_keys, size_t bits_per_key = 10);
+
+        // counters and size of the bloom filter since it was switched on (or reset)
+        bloom_filter_stats bloom_stats() const;
+        void reset_bloom_stats() { bloom_stats_ = bloom_filter_stats(); }
+
+        // switch the hash index on (true) or off (false)
+        // a hash table from key to node next to the tree, updated by every insert and by clear():
+        // find/count/operator[] by K then take O(1) expected time for present and absent keys,
+        // iteration and lower_bound still walk the tree. costs 16 bytes per slot, 21-43 bytes per
+        // key (included in shape_stats().bytes). front cache and bloom filter are not consulted
+        // while it is on. switching on indexes the whole tree once.
+        void hash_index(bool on);
+
+        // is the hash index switched on?
+        bool has_hash_index() const { return hash_index_ != nullptr; }
+
+        // switch scapegoat rebuilding on (0.5 < alpha < 1) or off (alpha == 0)
+        // when an insert lands deeper than log(size) / log(1 / alpha), the lowest ancestor with one
+        // child subtree holding more than alpha of its nodes is rebuilt perfectly balanced.
+        // smaller alpha: flatter tree, more rebuilding. switching on rebuilds the whole tree once.
+        // nodes are only relinked, so iterators, front cache and bloom filter stay valid.
+        void scapegoat(double alpha);
+
+        // the configured alpha, 0 if switched off
+        double scapegoat_alpha() const { return scapegoat_alpha_; }
+
+        // read-only view of the current contents in O(1), see treemap_snapshot.h
+        // while snapshots exist, insert/insert_or_assign/operator[] copy every shared node on their
+        // path before changing it. values written through an iterator are NOT copied first and show
+        // up in the snapshots too. iterators taken before a write may still see the old nodes.
+        snapshot_type snapshot() const;
+
+        // true if the hot-path counters are compiled in (-DTREEMAP_STATS)
+        static constexpr bool stats_enabled = treemap_stats_enabled;
+
+        // counters of this map since construction or reset_stats(), all zero if not compiled in.
+        // they stay with the object: swap and assignment exchange the contents, not the counters.
+        treemap_stats stats() const;
+        void reset_stats();
+
+        // height, leaf depths and memory footprint, walks the whole tree (O(n), no recursion)
+        treemap_shape shape_stats() const;
 
         iterator begin();
+        const_iterator begin() const;
+        const_iterator cbegin() const { return begin(); }
 
         // iterator end();
         iterator end() const;
+        const_iterator cend() const { return end(); }
+
+        // reverse iteration, rbegin() is the largest key
+        reverse_iterator rbegin() { return reverse_iterator(end()); }
+        reverse_iterator rend() { return reverse_iterator(begin()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+        const_reverse_iterator crbegin() const { return rbegin(); }
+        const_reverse_iterator crend() const { return rend(); }
         iterator find(const K &) const;
+        template <typename KK, typename C = Compare, typename = typename C::is_transparent>
+        iterator find(const KK &) const;
+
+        // first element whose key is not less than the given key, end() if there is none
+        iterator lower_bound(const K &) const;
+        template <typename KK, typename C = Compare, typename = typename C::is_transparent>
+        iterator lower_bound(const KK &) const;
+
+        // find() as a coroutine that prefetches the next node and suspends before every hop, to
+        // be interleaved with other lookups (see interleave() and find_batch()); with the hash
+        // index, bloom filter or front cache switched on it answers without suspending
+        lookup_task<iterator> co_find(K key) const;
+
+        // find() for every key in [first, last), results written to out in the same order
+        // width lookups are in flight at a time, so their cache misses overlap on one thread
+        template <typename It, typename Out>
+        void find_batch(It first, It last, Out out, size_t width = 16) const;
+
         std::pair<iterator, bool> insert(const K &, const T &);
         std::pair<iterator, bool> insert_or_assign(const K &, const T &);
 
+        // remove the element with this key, returns the number of removed elements (0 or 1)
+        // a node with two children is replaced by its in-order successor node (relinked, not
+        // copied), so only iterators to the removed element become invalid.
+        // the bloom filter keeps the key's bits; it is rebuilt once the erased keys reach half
+        // its capacity.
+        size_t erase(const K &);
+
+        // remove the element it points to (not end()), returns the iterator to the next element
+        iterator erase(iterator);
+
+        // insert (key, value) pairs given in strictly ascending key order, existing keys are kept
+        // each key continues from the previous insertion point instead of descending from the root
+        // (finger insertion), so a sorted batch touches every node on its paths only once.
+        // returns the number of inserted elements
+        template <typename It>
+        size_t insert_sorted(It first, It last);
+
+        // the same, but existing keys get the value from the batch
+        template <typename It>
+        size_t insert_or_assign_sorted(It first, It last);
+
+        // apply a delta from diff() (see treemap_diff.h): the upserts as one sorted batch, then
+        // the removals. turns a copy of diff's first map into its second one, at a cost that
+        // depends on the size of the delta only
+        void apply(const treemap_delta<K, T> &delta);
+
     protected:
         // the node type is only used internally - do not show publicly!
         using node = my::treemap_node<K, T>;    // from treemap_node.h
@@ -90,6 +294,71 @@ namespace my
         // class attributes
         node_ptr root_;
         size_t count_;
+        [[no_unique_address]] Compare comp_;
+
+        // front cache slot: a recently found node and how often it was hit since
+        struct cache_slot
+        {
+            node *node_ = nullptr;
+            unsigned hits_ = 0;
+        };
+
+        // front cache slots, empty if switched off
+        mutable std::vector<cache_slot> front_cache_;
+
+        // bloom filter over all keys, nullptr if switched off
+        std::unique_ptr<blocked_bloom_filter> bloom_;
+        mutable bloom_filter_stats bloom_stats_;
+        // erased keys whose bits are still set, the filter is rebuilt when they reach half its capacity
+        size_t bloom_stale_ = 0;
+
+        // hash index over all nodes, nullptr if switched off
+        std::unique_ptr<node_hash_index<node>> hash_index_;
+
+        // scapegoat rebuilding, alpha 0 if switched off
+        double scapegoat_alpha_ = 0;
+
+        // memory for new nodes, nullptr: make_shared
+        std::pmr::memory_resource *node_resource_ = nullptr;
+
+        // new node from node_resource_ (mapped: a T or default_value)
+        template <typename M>
+        node_ptr new_node_(const K &key, const M &mapped, node *up) const { return node::make(key, mapped, up, node_resource_); }
+
+        // one reference per living snapshot (plus this one), created by the first snapshot()
+        mutable std::shared_ptr<char> snapshot_token_;
+
+        // may nodes be shared with a snapshot?
+        bool sharing_() const { return snapshot_token_ && snapshot_token_.use_count() > 1; }
+
+        // insert_ while snapshots exist: copies every shared node on the path (path copying)
+        template <typename M>
+        std::pair<node_ptr, bool> insert_shared_(const K &, const M &, size_t &visited);
+
+        // replace the shared node in slot by a private copy below parent (nullptr for the root)
+        void clone_(node_ptr &slot, node *parent);
+
+        // clone all shared nodes of the subtree in slot, before changing its links
+        void unshare_subtree_(node_ptr &slot, node *parent);
+
+        // unlink n from the tree, all nodes whose links change must be private
+        void erase_node_(node *n);
+
+#ifdef TREEMAP_STATS
+        // hot-path counters, updated by const lookups too
+        mutable treemap_stats stats_;
+#endif
+
+        // comp_(a, b), counted
+        template <typename A, typename B>
+        bool compare_(const A &a, const B &b) const
+        {
+            TREEMAP_COUNT(&stats_, comparisons, 1);
+            return comp_(a, b);
+        }
+
+        // iterator to n, end() if n is nullptr
+        iterator make_iterator_(node *n) const;
 
         // add a new (key, value) pait into the tree
         // returns pair, consisting of:
@@ -97,35 +366,298 @@ namespace my
         // - bool
         //   - true if element was inserted;
         //   - false if key was already in map (will not overwrite existing value)
-        std::pair<node_ptr, bool> insert_(const K &, const T &);
+        // mapped is a T or default_value (constructed in the new node only)
+        template <typename M>
+        std::pair<node_ptr, bool> insert_(const K &, const M &);
 
         // find element with specific key. returns nullptr if not found.
-        node_ptr find_(const K &) const;
+        template <typename KK>
+        node *find_(const KK &) const;
+
+        // find_ for lookups by K when the bloom filter or the front cache is on (one hash for both)
+        node *find_hashed_(const K &) const;
+
+        // add a newly inserted key to the bloom filter, growing the filter if it is full
+        void bloom_add_(const K &);
+
+        // add a newly inserted node to the hash index (if it is on)
+        void index_add_(node *n);
+
+        // after inserting n with depth edges above it: rebuild the scapegoat subtree if n is too deep
+        // returns true if a subtree was rebuilt
+        bool scapegoat_check_(node *n, size_t depth);
+
+        // insert_sorted with a choice per element: assign(element) == true overwrites an existing value
+        template <typename It, typename Assign>
+        size_t insert_sorted_(It first, It last, Assign assign);
+
+        // buffered_treemap merges its buffer through insert_sorted_
+        template <typename KK, typename TT, typename CC>
+        friend class buffered_treemap;
+
+        // balanced subtree of new nodes for sorted[first, last), the halves on separate threads
+        // while threads > 1
+        static node_ptr build_from_sorted_(std::vector<std::pair<K, T>> &sorted, size_t first, size_t last, node *up, unsigned threads,
+                                           std::pmr::memory_resource *resource);
+
+        // rebuild the subtree rooted at n perfectly balanced, reusing its nodes
+        void rebuild_(node *n);
+
+        // link sorted[first, last) as a balanced subtree below up, returns its root
+        static node_ptr build_balanced_(std::vector<node_ptr> &sorted, size_t first, size_t last, node *up);
+
+        // refill the bloom filter from the tree, sized for expected_keys
+        void bloom_rebuild_(size_t expected_keys, size_t bits_per_key);
+
+        // call f(node *) for every node, in no particular order (no recursion, safe for deep trees)
+        template <typename F>
+        void for_each_node_(F f) const;
+
+        // first node whose key is not less than the given key. returns nullptr if there is none.
+        template <typename KK>
+        node *lower_bound_(const KK &) const;
     };
 
-    template <typename K, typename T>
-    typename treemap<K, T>::iterator treemap<K, T>::find(const K &key) const
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::iterator treemap<K, T, Compare>::find(const K &key) const
+    {
+        return make_iterator_(find_(key));
+    }
+
+    template <typename K, typename T, typename Compare>
+    template <typename KK, typename C, typename>
+    typename treemap<K, T, Compare>::iterator treemap<K, T, Compare>::find(const KK &key) const
+    {
+        return make_iterator_(find_(key));
+    }
+
+    template <typename K, typename T, typename Compare>
+    template <typename Range>
+    treemap<K, T, Compare> treemap<K, T, Compare>::from_unsorted(Range &&range, const build_policy &policy, const Compare &comp)
     {
-        node_ptr found_node = find_(key);
-        if (found_node != nullptr)
+        std::vector<std::pair<K, T>> sorted;
+        if constexpr (std::is_same_v<Range, std::vector<std::pair<K, T>>>)
         {
-            return iterator(found_node);
+            sorted = std::move(range);
         }
         else
         {
-            return end();
+            sorted.assign(std::begin(range), std::end(range));
+        }
+
+        unsigned threads = parallel_detail::thread_count(policy.threads, sorted.size(), size_t(1) << 14);
+        auto less = [&comp](const std::pair<K, T> &a, const std::pair<K, T> &b)
+        { return comp(a.first, b.first); };
+        parallel_detail::stable_sort(sorted, less, threads);
+
+        // one element per run of equal keys: the first or the last in input order
+        // (first: compared with the last kept element, the one before it may be moved out)
+        auto out = sorted.begin();
+        for (auto it = sorted.begin(); it != sorted.end(); ++it)
+        {
+            bool keep = policy.duplicates == duplicate_keys::last_wins
+                            ? std::next(it) == sorted.end() || less(*it, *std::next(it))
+                            : out == sorted.begin() || less(*std::prev(out), *it);
+            if (keep)
+            {
+                if (out != it)
+                {
+                    *out = std::move(*it);
+                }
+                ++out;
+            }
         }
+        sorted.erase(out, sorted.end());
+
+        treemap map(comp);
+        map.node_resource_ = policy.resource;
+        map.root_ = build_from_sorted_(sorted, 0, sorted.size(), nullptr, threads, policy.resource);
+        map.count_ = sorted.size();
+        TREEMAP_COUNT(&map.stats_, inserts, map.count_);
+        TREEMAP_COUNT(&map.stats_, node_allocations, map.count_);
+        return map;
+    }
+
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::node_ptr
+    treemap<K, T, Compare>::build_from_sorted_(std::vector<std::pair<K, T>> &sorted, size_t first, size_t last, node *up, unsigned threads,
+                                               std::pmr::memory_resource *resource)
+    {
+        if (first == last)
+        {
+            return nullptr;
+        }
+        size_t middle = first + (last - first) / 2;
+        node_ptr m = node::make(std::move(sorted[middle].first), std::move(sorted[middle].second), up, resource);
+        if (threads > 1 && last - first > (size_t(1) << 14))
+        {
+            // the subtrees share no nodes, node allocation is what scales
+            parallel_detail::parallel(2, [&](unsigned i)
+                                      {
+                if (i == 0)
+                {
+                    m->left_ = build_from_sorted_(sorted, first, middle, m.get(), threads / 2, resource);
+                }
+                else
+                {
+                    m->right_ = build_from_sorted_(sorted, middle + 1, last, m.get(), threads - threads / 2, resource);
+                } });
+        }
+        else
+        {
+            m->left_ = build_from_sorted_(sorted, first, middle, m.get(), 1, resource);
+            m->right_ = build_from_sorted_(sorted, middle + 1, last, m.get(), 1, resource);
+        }
+        return m;
+    }
+
+    template <typename K, typename T, typename Compare>
+    lookup_task<typename treemap<K, T, Compare>::iterator> treemap<K, T, Compare>::co_find(K key) const
+    {
+        // the key is a copy: the frame outlives the caller's expression
+        if constexpr (is_hashable<K>::value)
+        {
+            if (!front_cache_.empty() || bloom_ || hash_index_)
+            {
+                co_return make_iterator_(find_hashed_(key));
+            }
+        }
+
+        // lower_bound_, with a suspension before each node is read
+        TREEMAP_COUNT(&stats_, lookups, 1);
+        node *current = root_.get();
+        node *result = nullptr;
+        while (current != nullptr)
+        {
+            co_await prefetch_hop(current);
+            TREEMAP_COUNT(&stats_, lookup_nodes_visited, 1);
+            if (!compare_(current->value_.first, key))
+            {
+                result = current;
+                current = current->left_.get();
+            }
+            else
+            {
+                current = current->right_.get();
+            }
+        }
+        co_return make_iterator_(result != nullptr && !compare_(key, result->value_.first) ? result : nullptr);
+    }
+
+    template <typename K, typename T, typename Compare>
+    template <typename It, typename Out>
+    void treemap<K, T, Compare>::find_batch(It first, It last, Out out, size_t width) const
+    {
+        // tasks are made in key order, results arrive in any order
+        std::vector<iterator> found(size_t(std::distance(first, last)));
+        interleave(
+            found.size(), [&](size_t)
+            { return co_find(*first++); },
+            [&](size_t i, iterator it)
+            { found[i] = it; },
+            width);
+        std::copy(found.begin(), found.end(), out);
+    }
+
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::iterator treemap<K, T, Compare>::lower_bound(const K &key) const
+    {
+        return make_iterator_(lower_bound_(key));
+    }
+
+    template <typename K, typename T, typename Compare>
+    template <typename KK, typename C, typename>
+    typename treemap<K, T, Compare>::iterator treemap<K, T, Compare>::lower_bound(const KK &key) const
+    {
+        return make_iterator_(lower_bound_(key));
     }
 
-    template <typename K, typename T>
-    typename treemap<K, T>::iterator treemap<K, T>::end() const
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::iterator treemap<K, T, Compare>::end() const
     {
-        // Iterator that Points to end of tree with weakpointer to root
-        return iterator(nullptr, root_);
+        // Iterator that Points to end of tree with pointer to root
+        return make_iterator_(nullptr);
     }
 
-    template <typename K, typename T>
-    typename treemap<K, T>::iterator treemap<K, T>::begin()
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::iterator treemap<K, T, Compare>::make_iterator_(node *n) const
+    {
+        return iterator(n, &root_);
+    }
+
+    template <typename K, typename T, typename Compare>
+    treemap_stats treemap<K, T, Compare>::stats() const
+    {
+#ifdef TREEMAP_STATS
+        return stats_;
+#else
+        return treemap_stats();
+#endif
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::reset_stats()
+    {
+#ifdef TREEMAP_STATS
+        stats_ = treemap_stats();
+#endif
+    }
+
+    template <typename K, typename T, typename Compare>
+    treemap_shape treemap<K, T, Compare>::shape_stats() const
+    {
+        treemap_shape shape;
+        shape.count = count_;
+
+        // explicit stack of (node, level), a degenerate tree would overflow the call stack
+        size_t leaf_depth_sum = 0;
+        std::vector<std::pair<node *, size_t>> stack;
+        if (root_)
+        {
+            stack.emplace_back(root_.get(), 1);
+        }
+        while (!stack.empty())
+        {
+            auto [n, depth] = stack.back();
+            stack.pop_back();
+            shape.nodes++;
+            shape.height = std::max(shape.height, depth);
+            if (!n->left_ && !n->right_)
+            {
+                shape.leaves++;
+                leaf_depth_sum += depth;
+                shape.min_leaf_depth = shape.leaves == 1 ? depth : std::min(shape.min_leaf_depth, depth);
+                shape.max_leaf_depth = std::max(shape.max_leaf_depth, depth);
+            }
+            if (n->left_)
+            {
+                stack.emplace_back(n->left_.get(), depth + 1);
+            }
+            if (n->right_)
+            {
+                stack.emplace_back(n->right_.get(), depth + 1);
+            }
+        }
+        if (shape.leaves > 0)
+        {
+            shape.average_leaf_depth = double(leaf_depth_sum) / double(shape.leaves);
+        }
+
+        // make_shared puts node and control block (vtable pointer, two counters) into one allocation,
+        // glibc malloc adds an 8 byte header and rounds chunks up to 16 bytes (at least 32)
+        size_t block = sizeof(node) + sizeof(void *) + 2 * sizeof(int);
+        shape.bytes_per_node = std::max<size_t>(32, (block + sizeof(size_t) + 15) / 16 * 16);
+        shape.bytes = sizeof(*this) + shape.nodes * shape.bytes_per_node +
+                      front_cache_.capacity() * sizeof(cache_slot) + (bloom_ ? bloom_->bytes() : 0) +
+                      (hash_index_ ? hash_index_->bytes() : 0);
+
+        // a red-black tree is never higher than 2 * log2(n + 1)
+        shape.rebalance_recommended = shape.height > 2 * std::bit_width(shape.nodes);
+        return shape;
+    }
+
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::iterator treemap<K, T, Compare>::begin()
     {
         // test if tree is empty - in case return end()(nullptr)
         if (root_ == nullptr)
@@ -137,41 +669,178 @@ namespace my
         node_ptr min_node = root_->find_min();
 
         // Iterator that points on min_node
-        return iterator(min_node);
+        return make_iterator_(min_node.get());
+    }
+
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::const_iterator treemap<K, T, Compare>::begin() const
+    {
+        // leftmost node, nullptr (end()) for an empty tree
+        node *n = root_.get();
+        while (n != nullptr && n->left_)
+        {
+            n = n->left_.get();
+        }
+        return make_iterator_(n);
     }
 
-    template <typename K, typename T>
+    template <typename K, typename T, typename Compare>
     void
-    treemap<K, T>::clear()
+    treemap<K, T, Compare>::clear()
     {
         // root = nullptr da alle smartpointer destruktor aufrufen
         root_ = nullptr;
         count_ = 0;
+        // snapshots keep the old nodes, nothing is shared any more
+        snapshot_token_.reset();
+        std::fill(front_cache_.begin(), front_cache_.end(), cache_slot());
+        if (bloom_)
+        {
+            bloom_->clear();
+            bloom_stale_ = 0;
+        }
+        if (hash_index_)
+        {
+            hash_index_->clear();
+        }
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::front_cache(size_t slots)
+    {
+        static_assert(is_hashable<K>::value, "front cache needs std::hash<K>");
+        front_cache_.assign(slots == 0 ? 0 : std::bit_ceil(slots), cache_slot());
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::bloom_filter(size_t expected_keys, size_t bits_per_key)
+    {
+        static_assert(is_hashable<K>::value, "bloom filter needs std::hash<K>");
+        bloom_stats_ = bloom_filter_stats();
+        if (expected_keys == 0)
+        {
+            bloom_.reset();
+            return;
+        }
+        bloom_rebuild_(std::max(expected_keys, count_), bits_per_key);
+    }
+
+    template <typename K, typename T, typename Compare>
+    bloom_filter_stats treemap<K, T, Compare>::bloom_stats() const
+    {
+        bloom_filter_stats result = bloom_stats_;
+        result.bytes = bloom_ ? bloom_->bytes() : 0;
+        return result;
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::hash_index(bool on)
+    {
+        static_assert(is_hashable<K>::value, "hash index needs std::hash<K>");
+        hash_index_.reset();
+        if (on)
+        {
+            hash_index_ = std::make_unique<node_hash_index<node>>(count_);
+            for_each_node_([&](node *n)
+                           { hash_index_->insert(std::hash<K>{}(n->value_.first), n); });
+        }
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::index_add_(node *n)
+    {
+        if constexpr (is_hashable<K>::value)
+        {
+            if (hash_index_)
+            {
+                hash_index_->insert(std::hash<K>{}(n->value_.first), n);
+            }
+        }
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::bloom_add_(const K &key)
+    {
+        if constexpr (is_hashable<K>::value)
+        {
+            if (count_ > bloom_->capacity())
+            {
+                // a full filter would let more and more misses through, rebuild it twice as large
+                bloom_rebuild_(2 * count_, bloom_->bits_per_key());
+            }
+            else
+            {
+                bloom_->add(std::hash<K>{}(key));
+            }
+        }
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::bloom_rebuild_(size_t expected_keys, size_t bits_per_key)
+    {
+        if constexpr (is_hashable<K>::value)
+        {
+            auto filter = std::make_unique<blocked_bloom_filter>(expected_keys, bits_per_key);
+            for_each_node_([&](node *n)
+                           { filter->add(std::hash<K>{}(n->value_.first)); });
+            bloom_ = std::move(filter);
+            bloom_stale_ = 0;
+        }
+    }
+
+    template <typename K, typename T, typename Compare>
+    template <typename F>
+    void treemap<K, T, Compare>::for_each_node_(F f) const
+    {
+        std::vector<node *> stack;
+        if (root_)
+        {
+            stack.push_back(root_.get());
+        }
+        while (!stack.empty())
+        {
+            node *n = stack.back();
+            stack.pop_back();
+            f(n);
+            if (n->left_)
+            {
+                stack.push_back(n->left_.get());
+            }
+            if (n->right_)
+            {
+                stack.push_back(n->right_.get());
+            }
+        }
     }
 
     // random write access to value by key
-    // if key is not in map, insert new (key, T())
-    template <typename K, typename T>
+    // if key is not in map, insert new (key, T()), the T() constructed in the node itself
+    template <typename K, typename T, typename Compare>
     T &
-    treemap<K, T>::operator[](const K &key)
+    treemap<K, T, Compare>::operator[](const K &key)
     {
+        // a found node may be shared with a snapshot, then only insert_ makes it private
+        if (sharing_())
+        {
+            return insert_(key, default_value).first->value_.second;
+        }
+
         // Versuchen Sie, den Schlüssel zu finden
-        node_ptr node = find_(key);
+        node *found = find_(key);
 
         // Wenn der Schlüssel nicht gefunden wurde, wird ein neuer knoten erzeugt
-        if (!node)
+        if (!found)
         {
-            // tie teilt das ergebnis von insert auf der zeiger ist node und rest wird ignoriert
-            std::tie(node, std::ignore) = insert_(key, T());
+            found = insert_(key, default_value).first.get();
         }
 
         // Geben Sie den Wert des gefundenen oder eingefügten Knotens zurück
-        return node->value_.second;
+        return found->value_.second;
     }
 
     // number of elements in map (nodes in tree)
-    template <typename K, typename T>
-    size_t treemap<K, T>::size() const
+    template <typename K, typename T, typename Compare>
+    size_t treemap<K, T, Compare>::size() const
     {
 
         return count_;
@@ -181,94 +850,747 @@ namespace my
     // returns:
     // - pointer to element
     // - true if element was inserted; false if key was already in map
-    template <typename K, typename T>
-    std::pair<typename treemap<K, T>::node_ptr, bool>
-    treemap<K, T>::insert_(const K &key, const T &mapped)
+    template <typename K, typename T, typename Compare>
+    template <typename M>
+    std::pair<typename treemap<K, T, Compare>::node_ptr, bool>
+    treemap<K, T, Compare>::insert_(const K &key, const M &mapped)
     {
         // Wenn root nllprt, erstellen eines neues knotens und zähler erhöhen
-        if (!root_)
+        TREEMAP_COUNT(&stats_, inserts, 1);
+        std::pair<node_ptr, bool> result;
+        size_t visited = 0;
+        if (sharing_())
         {
-            root_ = std::make_shared<node>(key, mapped);
-            count_++;
-            return std::make_pair(root_, true);
+            result = insert_shared_(key, mapped, visited);
+        }
+        else if (!root_)
+        {
+            root_ = new_node_(key, mapped, nullptr);
+            result = std::make_pair(root_, true);
         }
-        // Ansonsten rekursive insert Methode des Knotens
+        // Ansonsten insert Methode des Knotens
         else
         {
+#ifdef TREEMAP_STATS
+            result = root_->insert(
+                key, mapped, [this](const auto &a, const auto &b)
+                { return compare_(a, b); },
+                &visited, node_resource_);
+#else
+            result = root_->insert(key, mapped, comp_, &visited, node_resource_);
+#endif
+        }
+        TREEMAP_COUNT(&stats_, insert_nodes_visited, visited);
+
+        // zähler nur erhöhen wenn wirklich eingefügt wurde
+        if (result.second)
+        {
+            TREEMAP_COUNT(&stats_, node_allocations, 1);
             count_++;
-            return root_->insert(key, mapped);
+            if (bloom_)
+            {
+                bloom_add_(key);
+            }
+            index_add_(result.first.get());
+            if (scapegoat_alpha_ != 0)
+            {
+                scapegoat_check_(result.first.get(), visited);
+            }
         }
+        return result;
     }
-    // find element with specific key. returns end() if not found.
-    template <typename K, typename T>
-    typename treemap<K, T>::node_ptr
-    treemap<K, T>::find_(const K &key) const
+
+    template <typename K, typename T, typename Compare>
+    template <typename It>
+    size_t treemap<K, T, Compare>::insert_sorted(It first, It last)
     {
-        node_ptr current = root_;
+        return insert_sorted_(first, last, [](const auto &)
+                              { return false; });
+    }
 
-        while (current != nullptr)
+    template <typename K, typename T, typename Compare>
+    template <typename It>
+    size_t treemap<K, T, Compare>::insert_or_assign_sorted(It first, It last)
+    {
+        return insert_sorted_(first, last, [](const auto &)
+                              { return true; });
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::apply(const treemap_delta<K, T> &delta)
+    {
+        insert_or_assign_sorted(delta.upserts.begin(), delta.upserts.end());
+        for (const K &key : delta.removed)
         {
-            if (key < current->value_.first)
+            erase(key);
+        }
+    }
+
+    // keeps the path from the root to the last inserted node, each node with the key bounding
+    // its subtree from above. keys ascend, so the next key belongs below the deepest node on the
+    // path whose bound is still greater - the nodes below that bound are popped.
+    template <typename K, typename T, typename Compare>
+    template <typename It, typename Assign>
+    size_t treemap<K, T, Compare>::insert_sorted_(It first, It last, Assign assign)
+    {
+        struct step
+        {
+            node *node_;
+            node *upper_; // nullptr: unbounded
+        };
+        std::vector<step> path;
+        size_t inserted = 0;
+
+        // into an empty tree one by one the batch would become a list: build it balanced instead
+        if (!root_ && first != last)
+        {
+            std::vector<node_ptr> sorted;
+            for (; first != last; ++first)
+            {
+                sorted.push_back(new_node_(first->first, first->second, nullptr));
+                TREEMAP_COUNT(&stats_, inserts, 1);
+                TREEMAP_COUNT(&stats_, node_allocations, 1);
+                index_add_(sorted.back().get());
+            }
+            root_ = build_balanced_(sorted, 0, sorted.size(), nullptr);
+            count_ = sorted.size();
+            // one rebuild sized for the whole batch (adding key by key would never grow the filter)
+            if (bloom_)
+            {
+                bloom_rebuild_(std::max(count_, bloom_->capacity()), bloom_->bits_per_key());
+            }
+            return count_;
+        }
+
+        for (; first != last; ++first)
+        {
+            const K &key = first->first;
+            const T &mapped = first->second;
+
+            // shared nodes must be copied on the way down, the plain insert does that
+            if (sharing_())
             {
+                auto result = insert_(key, mapped);
+                if (!result.second && assign(*first))
+                {
+                    result.first->value_.second = mapped;
+                }
+                inserted += result.second;
+                path.clear();
+                continue;
+            }
+
+            TREEMAP_COUNT(&stats_, inserts, 1);
+            while (!path.empty() && path.back().upper_ != nullptr && !compare_(key, path.back().upper_->value_.first))
+            {
+                path.pop_back();
+            }
+
+            // start below the last node kept (or at the root), one comparison per node as in insert
+            node *current = path.empty() ? root_.get() : path.back().node_;
+            node *upper = path.empty() ? nullptr : path.back().upper_;
+            if (!path.empty())
+            {
+                path.pop_back();
+            }
+            node *not_greater = nullptr;
+            bool go_left = false;
+            for (;;)
+            {
+                path.push_back({current, upper});
+                TREEMAP_COUNT(&stats_, insert_nodes_visited, 1);
+                go_left = compare_(key, current->value_.first);
+                if (go_left)
+                {
+                    upper = current;
+                }
+                else
+                {
+                    not_greater = current;
+                }
+                node_ptr &next = go_left ? current->left_ : current->right_;
+                if (!next)
+                {
+                    break;
+                }
+                current = next.get();
+            }
+
+            // nodes above the starting point are smaller than the previous key, so an equal key
+            // can only have been passed on the way down
+            if (not_greater != nullptr && !compare_(not_greater->value_.first, key))
+            {
+                if (assign(*first))
+                {
+                    not_greater->value_.second = mapped;
+                }
+                continue;
+            }
+
+            node_ptr &slot = go_left ? current->left_ : current->right_;
+            slot = new_node_(key, mapped, current);
+            path.push_back({slot.get(), upper});
+            TREEMAP_COUNT(&stats_, node_allocations, 1);
+            count_++;
+            inserted++;
+            if (bloom_)
+            {
+                bloom_add_(key);
+            }
+            index_add_(slot.get());
+            if (scapegoat_alpha_ != 0 && scapegoat_check_(slot.get(), path.size() - 1))
+            {
+                // relinked nodes: the path is no longer valid
+                path.clear();
+            }
+        }
+        return inserted;
+    }
+
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::snapshot_type treemap<K, T, Compare>::snapshot() const
+    {
+        if (!snapshot_token_)
+        {
+            snapshot_token_ = std::make_shared<char>();
+        }
+        return snapshot_type(root_, count_, comp_, snapshot_token_);
+    }
+
+    // a node is shared if more than one parent link (or snapshot root) owns it. copying a node
+    // makes its children shared in turn, so they are copied when the path reaches them.
+    // children of a copy get their up_ pointed at the copy - snapshots never follow up_.
+    template <typename K, typename T, typename Compare>
+    template <typename M>
+    std::pair<typename treemap<K, T, Compare>::node_ptr, bool>
+    treemap<K, T, Compare>::insert_shared_(const K &key, const M &mapped, size_t &visited)
+    {
+        node_ptr *slot = &root_;
+        node *parent = nullptr;
+        node *not_greater = nullptr;
+        while (*slot)
+        {
+            if (slot->use_count() > 1)
+            {
+                clone_(*slot, parent);
+            }
+            node *current = slot->get();
+            visited++;
+            bool go_left = compare_(key, current->value_.first);
+            if (!go_left)
+            {
+                not_greater = current;
+            }
+            parent = current;
+            slot = go_left ? &current->left_ : &current->right_;
+        }
+
+        // the whole path is private now, the existing node may be changed by the caller
+        if (not_greater != nullptr && !compare_(not_greater->value_.first, key))
+        {
+            return std::make_pair(not_greater->shared_from_this(), false);
+        }
+
+        *slot = new_node_(key, mapped, parent);
+        return std::make_pair(*slot, true);
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::clone_(node_ptr &slot, node *parent)
+    {
+        TREEMAP_COUNT(&stats_, node_allocations, 1);
+        node_ptr copy = new_node_(slot->value_.first, slot->value_.second, parent);
+        copy->left_ = slot->left_;
+        copy->right_ = slot->right_;
+        if (copy->left_)
+        {
+            copy->left_->up_ = copy.get();
+        }
+        if (copy->right_)
+        {
+            copy->right_->up_ = copy.get();
+        }
+
+        // the front cache must not keep pointing at the snapshot's node
+        if constexpr (is_hashable<K>::value)
+        {
+            if (!front_cache_.empty())
+            {
+                cache_slot &cached = front_cache_[std::hash<K>{}(copy->value_.first) & (front_cache_.size() - 1)];
+                if (cached.node_ == slot.get())
+                {
+                    cached.node_ = copy.get();
+                }
+            }
+            // nor the hash index
+            if (hash_index_)
+            {
+                hash_index_->replace(std::hash<K>{}(copy->value_.first), slot.get(), copy.get());
+            }
+        }
+        slot = std::move(copy);
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::unshare_subtree_(node_ptr &slot, node *parent)
+    {
+        std::vector<std::pair<node_ptr *, node *>> stack;
+        if (slot)
+        {
+            stack.emplace_back(&slot, parent);
+        }
+        while (!stack.empty())
+        {
+            auto [s, up] = stack.back();
+            stack.pop_back();
+            if (s->use_count() > 1)
+            {
+                clone_(*s, up);
+            }
+            node *n = s->get();
+            if (n->left_)
+            {
+                stack.emplace_back(&n->left_, n);
+            }
+            if (n->right_)
+            {
+                stack.emplace_back(&n->right_, n);
+            }
+        }
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::scapegoat(double alpha)
+    {
+        assert(alpha == 0 || (alpha > 0.5 && alpha < 1));
+        scapegoat_alpha_ = alpha;
+        if (alpha != 0 && root_)
+        {
+            rebuild_(root_.get());
+        }
+    }
+
+    // scapegoat tree insertion (Galperin/Rivest): only a node that is deeper than the alpha
+    // height bound triggers work, and then an ancestor violating alpha weight balance must exist
+    template <typename K, typename T, typename Compare>
+    bool treemap<K, T, Compare>::scapegoat_check_(node *n, size_t depth)
+    {
+        // the bound is at least log2(count_) (alpha > 0.5), skip the logarithms for shallow nodes
+        if (depth < size_t(std::bit_width(count_)))
+        {
+            return false;
+        }
+        double bound = std::log(double(count_)) / std::log(1.0 / scapegoat_alpha_);
+        if (double(depth) <= bound)
+        {
+            return false;
+        }
+
+        // climb up, summing subtree sizes, until a child holds more than alpha of its parent
+        auto subtree_size = [](node *sub)
+        {
+            size_t size = 0;
+            std::vector<node *> stack;
+            if (sub != nullptr)
+            {
+                stack.push_back(sub);
+            }
+            while (!stack.empty())
+            {
+                node *m = stack.back();
+                stack.pop_back();
+                size++;
+                if (m->left_)
+                {
+                    stack.push_back(m->left_.get());
+                }
+                if (m->right_)
+                {
+                    stack.push_back(m->right_.get());
+                }
+            }
+            return size;
+        };
+
+        node *child = n;
+        size_t child_size = 1;
+        for (node *parent = child->up_; parent != nullptr; parent = parent->up_)
+        {
+            node *sibling = parent->left_.get() == child ? parent->right_.get() : parent->left_.get();
+            size_t parent_size = child_size + 1 + subtree_size(sibling);
+            if (double(child_size) > scapegoat_alpha_ * double(parent_size))
+            {
+                rebuild_(parent);
+                return true;
+            }
+            child = parent;
+            child_size = parent_size;
+        }
+        return false;
+    }
+
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::rebuild_(node *n)
+    {
+        node *up = n->up_;
+        node_ptr &slot = up == nullptr ? root_ : (up->left_.get() == n ? up->left_ : up->right_);
+        if (sharing_())
+        {
+            // relinking must not change what a snapshot sees
+            unshare_subtree_(slot, up);
+        }
+
+        // collect the subtree in order (iteratively, it may be a long list), the vector owns the nodes
+        std::vector<node_ptr> sorted;
+        std::vector<node_ptr> stack;
+        node_ptr current = slot;
+        while (current || !stack.empty())
+        {
+            while (current)
+            {
+                stack.push_back(current);
                 current = current->left_;
             }
-            else if (key > current->value_.first)
+            current = stack.back();
+            stack.pop_back();
+            sorted.push_back(current);
+            current = current->right_;
+        }
+        for (auto &m : sorted)
+        {
+            m->left_ = nullptr;
+            m->right_ = nullptr;
+        }
+
+        slot = build_balanced_(sorted, 0, sorted.size(), up);
+    }
+
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::node_ptr
+    treemap<K, T, Compare>::build_balanced_(std::vector<node_ptr> &sorted, size_t first, size_t last, node *up)
+    {
+        // recursion depth is log2 of the subtree size, the result is balanced
+        if (first == last)
+        {
+            return nullptr;
+        }
+        size_t middle = first + (last - first) / 2;
+        node_ptr &m = sorted[middle];
+        m->up_ = up;
+        m->left_ = build_balanced_(sorted, first, middle, m.get());
+        m->right_ = build_balanced_(sorted, middle + 1, last, m.get());
+        return m;
+    }
+
+    // lower bound: walk down with a single comparison per node, remember the last node
+    // whose key is not less than the searched key
+    template <typename K, typename T, typename Compare>
+    template <typename KK>
+    typename treemap<K, T, Compare>::node *
+    treemap<K, T, Compare>::lower_bound_(const KK &key) const
+    {
+        TREEMAP_COUNT(&stats_, lookups, 1);
+        node *current = root_.get();
+        node *result = nullptr;
+
+        while (current != nullptr)
+        {
+            TREEMAP_COUNT(&stats_, lookup_nodes_visited, 1);
+            if (!compare_(current->value_.first, key))
             {
-                current = current->right_;
+                result = current;
+                current = current->left_.get();
             }
             else
             {
-                return current;
+                current = current->right_.get();
+            }
+        }
+
+        return result;
+    }
+
+    // find element with specific key. returns nullptr if not found.
+    // the lower bound is the only candidate, one more comparison decides whether it matches
+    template <typename K, typename T, typename Compare>
+    template <typename KK>
+    typename treemap<K, T, Compare>::node *
+    treemap<K, T, Compare>::find_(const KK &key) const
+    {
+        // front cache, bloom filter and hash index are only used for K itself, other key types may hash differently
+        if constexpr (std::is_same_v<KK, K> && is_hashable<K>::value)
+        {
+            if (!front_cache_.empty() || bloom_ || hash_index_)
+            {
+                return find_hashed_(key);
+            }
+        }
+
+        node *candidate = lower_bound_(key);
+
+        if (candidate != nullptr && !compare_(key, candidate->value_.first))
+        {
+            return candidate;
+        }
+
+        return nullptr;
+    }
+
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::node *
+    treemap<K, T, Compare>::find_hashed_(const K &key) const
+    {
+        size_t hash = std::hash<K>{}(key);
+
+        // the index holds every node, its answer is final
+        if (hash_index_)
+        {
+            return hash_index_->find(hash, [&](node *n)
+                                     { return !compare_(key, n->value_.first) && !compare_(n->value_.first, key); });
+        }
+
+        // the filter has no false negatives, so "not contained" is final
+        if (bloom_)
+        {
+            bloom_stats_.queries++;
+            if (!bloom_->may_contain(hash))
+            {
+                bloom_stats_.negatives++;
+                return nullptr;
+            }
+        }
+
+        cache_slot *slot = nullptr;
+        if (!front_cache_.empty())
+        {
+            slot = &front_cache_[hash & (front_cache_.size() - 1)];
+            if (slot->node_ != nullptr && !compare_(key, slot->node_->value_.first) && !compare_(slot->node_->value_.first, key))
+            {
+                if (slot->hits_ < 255)
+                {
+                    slot->hits_++;
+                }
+                return slot->node_;
             }
         }
 
+        node *candidate = lower_bound_(key);
+
+        if (candidate != nullptr && !compare_(key, candidate->value_.first))
+        {
+            // replace the cached node only when it has not been hit more often than missed
+            if (slot != nullptr)
+            {
+                if (slot->hits_ == 0)
+                {
+                    slot->node_ = candidate;
+                    slot->hits_ = 1;
+                }
+                else
+                {
+                    slot->hits_--;
+                }
+            }
+            return candidate;
+        }
+
+        if (bloom_)
+        {
+            bloom_stats_.false_positives++;
+        }
         return nullptr;
     }
 
     // how often is the element contained in the map?
-    template <typename K, typename T>
-    
-    size_t treemap<K, T>::count(const K &key) const
+    template <typename K, typename T, typename Compare>
+    size_t treemap<K, T, Compare>::count(const K &key) const
+    {
+        return find_(key) == nullptr ? 0 : 1;
+    }
+
+    template <typename K, typename T, typename Compare>
+    template <typename KK, typename C, typename>
+    size_t treemap<K, T, Compare>::count(const KK &key) const
     {
         return find_(key) == nullptr ? 0 : 1;
     }
 
     // for iterator
-    
-    template <typename K, typename T>
-    std::pair<typename treemap<K, T>::iterator, bool> treemap<K, T>::insert(const K &key, const T &value)
+    // insert_ already returns the existing node if the key is present, so only one descent is needed
+    template <typename K, typename T, typename Compare>
+    std::pair<typename treemap<K, T, Compare>::iterator, bool> treemap<K, T, Compare>::insert(const K &key, const T &value)
     {
-        auto existing_node = find_(key);
-        if (existing_node != nullptr)
-        {
-            // falls key vorhanden wird nichts eingefühgt
-            return std::make_pair(iterator(existing_node), false);
-        }
-        // Einfügen eines neuen elements
         auto insert_result = insert_(key, value);
-        return std::make_pair(iterator(insert_result.first), insert_result.second);
+        return std::make_pair(make_iterator_(insert_result.first.get()), insert_result.second);
     }
 
-    template <typename K, typename T>
-    std::pair<typename treemap<K, T>::iterator, bool> treemap<K, T>::insert_or_assign(const K &key, const T &value)
+    template <typename K, typename T, typename Compare>
+    std::pair<typename treemap<K, T, Compare>::iterator, bool> treemap<K, T, Compare>::insert_or_assign(const K &key, const T &value)
     {
-        auto existing_node = find_(key);
-        if (existing_node != nullptr)
+        auto insert_result = insert_(key, value);
+        if (!insert_result.second)
         {
             // falls der schlüssel gefunden wurde wird der wert aktualisiert
-            existing_node->value_.second = value;
             // gibt trotzdem false zurück da ja kein neuer knoten erzeugt wurde sondern nur value überschrieben
-            return std::make_pair(iterator(existing_node), false);
+            insert_result.first->value_.second = value;
         }
-        // Einfügen eines neuen elements
-        auto insert_result = insert_(key, value);
-        return std::make_pair(iterator(insert_result.first), insert_result.second);
+        return std::make_pair(make_iterator_(insert_result.first.get()), insert_result.second);
+    }
+
+
+    template <typename K, typename T, typename Compare>
+    size_t treemap<K, T, Compare>::erase(const K &key)
+    {
+        if (!sharing_())
+        {
+            node *n = find_(key);
+            if (n == nullptr)
+            {
+                return 0;
+            }
+            erase_node_(n);
+            return 1;
+        }
+
+        // copy-on-write: the path to the node and, for two children, on to its successor
+        node_ptr *slot = &root_;
+        node *parent = nullptr;
+        node *found = nullptr;
+        while (*slot && found == nullptr)
+        {
+            if (slot->use_count() > 1)
+            {
+                clone_(*slot, parent);
+            }
+            node *current = slot->get();
+            if (compare_(key, current->value_.first))
+            {
+                slot = &current->left_;
+            }
+            else if (compare_(current->value_.first, key))
+            {
+                slot = &current->right_;
+            }
+            else
+            {
+                found = current;
+            }
+            parent = current;
+        }
+        if (found == nullptr)
+        {
+            return 0;
+        }
+        if (found->left_ && found->right_)
+        {
+            for (slot = &found->right_, parent = found; *slot; slot = &(*slot)->left_)
+            {
+                if (slot->use_count() > 1)
+                {
+                    clone_(*slot, parent);
+                }
+                parent = slot->get();
+            }
+        }
+        erase_node_(found);
+        return 1;
+    }
+
+    template <typename K, typename T, typename Compare>
+    typename treemap<K, T, Compare>::iterator treemap<K, T, Compare>::erase(iterator it)
+    {
+        assert(it.node_ != nullptr);
+        if (sharing_())
+        {
+            // the nodes around it are about to be copied, find the next element by key afterwards
+            K key = it->first;
+            erase(key);
+            return make_iterator_(lower_bound_(key));
+        }
+        node *n = it.node_;
+        ++it;
+        erase_node_(n);
+        return it;
     }
 
+    template <typename K, typename T, typename Compare>
+    void treemap<K, T, Compare>::erase_node_(node *n)
+    {
+        if constexpr (is_hashable<K>::value)
+        {
+            if (!front_cache_.empty() || hash_index_)
+            {
+                size_t hash = std::hash<K>{}(n->value_.first);
+                if (!front_cache_.empty())
+                {
+                    cache_slot &cached = front_cache_[hash & (front_cache_.size() - 1)];
+                    if (cached.node_ == n)
+                    {
+                        cached = cache_slot();
+                    }
+                }
+                if (hash_index_)
+                {
+                    hash_index_->erase(hash, n);
+                }
+            }
+        }
+
+        node *up = n->up_;
+        node_ptr &slot = up == nullptr ? root_ : (up->left_.get() == n ? up->left_ : up->right_);
+        // keeps n alive until its links are no longer needed
+        node_ptr removed = slot;
+        if (!n->left_ || !n->right_)
+        {
+            // at most one child: it takes n's place
+            node_ptr child = n->left_ ? n->left_ : n->right_;
+            if (child)
+            {
+                child->up_ = up;
+            }
+            slot = std::move(child);
+        }
+        else
+        {
+            // two children: the leftmost node of the right subtree takes n's place
+            node *s = n->right_.get();
+            while (s->left_)
+            {
+                s = s->left_.get();
+            }
+            node_ptr successor = s->up_ == n ? n->right_ : s->up_->left_;
+            if (s->up_ != n)
+            {
+                node *successor_parent = s->up_;
+                successor_parent->left_ = s->right_;
+                if (successor_parent->left_)
+                {
+                    successor_parent->left_->up_ = successor_parent;
+                }
+                s->right_ = n->right_;
+                s->right_->up_ = s;
+            }
+            s->left_ = n->left_;
+            s->left_->up_ = s;
+            s->up_ = up;
+            slot = std::move(successor);
+        }
+        n->left_ = nullptr;
+        n->right_ = nullptr;
+        count_--;
+
+        // stale bits would fill the filter under steady churn (count_ stays flat, so inserts
+        // never trigger the rebuild), until every miss is a false positive
+        if (bloom_ && ++bloom_stale_ > std::max<size_t>(1, bloom_->capacity() / 2))
+        {
+            bloom_rebuild_(std::max(count_, bloom_->capacity()), bloom_->bits_per_key());
+        }
+    }
 
     // copy recursive
 template <typename K, typename T>
-static std::shared_ptr<treemap_node<K, T>> copy_recursive(const std::shared_ptr<treemap_node<K, T>> &original_node)
+static std::shared_ptr<treemap_node<K, T>> copy_recursive(const std::shared_ptr<treemap_node<K, T>> &original_node,
+                                                          std::pmr::memory_resource *resource)
 {
     
     if (!original_node)
@@ -278,25 +1600,25 @@ static std::shared_ptr<treemap_node<K, T>> copy_recursive(const std::shared_ptr<
 
     // Erstellen eines neuen Knotens, der eine Kopie des aktuellen Knotens ist.
     // erstellen neuer knoten, kopie des aktuellen knotens
-    auto new_node = std::make_shared<treemap_node<K, T>>(original_node->value_.first, original_node->value_.second);
+    auto new_node = treemap_node<K, T>::make(original_node->value_.first, original_node->value_.second, nullptr, resource);
     
     
     // rekursiver aufruf zur deepcopy des linken teilbazmns
-    new_node->left_ = copy_recursive(original_node->left_);
+    new_node->left_ = copy_recursive(original_node->left_, resource);
 
     // setzen des pointers auf den erltern knoten
     if (new_node->left_)
     {
-        new_node->left_->up_ = new_node;
+        new_node->left_->up_ = new_node.get();
     }
 
    // rekursiver aufruf zur deepcopy des rechten teilbazmns
-    new_node->right_ = copy_recursive(original_node->right_);
+    new_node->right_ = copy_recursive(original_node->right_, resource);
 
     // setzen des pointers auf den erltern knoten
     if (new_node->right_)
     {
-        new_node->right_->up_ = new_node;
+        new_node->right_->up_ = new_node.get();
     }
 
 
@@ -305,8 +1627,8 @@ static std::shared_ptr<treemap_node<K, T>> copy_recursive(const std::shared_ptr<
 
 
 
-    template <typename K, typename T>
-    treemap<K, T> &treemap<K, T>::operator=(treemap rhs)
+    template <typename K, typename T, typename Compare>
+    treemap<K, T, Compare> &treemap<K, T, Compare>::operator=(treemap rhs)
     {
         swap(*this, rhs);
         return *this;
@@ -316,9 +1638,18 @@ static std::shared_ptr<treemap_node<K, T>> copy_recursive(const std::shared_ptr<
 
 // swap contents of two trees
 // this is defined in the global namespace, for reasons... (see StackOverflow)
-template <typename KK, typename TT>
-void swap(my::treemap<KK, TT> &lhs, my::treemap<KK, TT> &rhs)
+template <typename KK, typename TT, typename CC>
+void swap(my::treemap<KK, TT, CC> &lhs, my::treemap<KK, TT, CC> &rhs)
 {
     std::swap(lhs.root_, rhs.root_);
     std::swap(lhs.count_, rhs.count_);
+    std::swap(lhs.comp_, rhs.comp_);
+    std::swap(lhs.front_cache_, rhs.front_cache_);
+    std::swap(lhs.bloom_, rhs.bloom_);
+    std::swap(lhs.bloom_stats_, rhs.bloom_stats_);
+    std::swap(lhs.bloom_stale_, rhs.bloom_stale_);
+    std::swap(lhs.hash_index_, rhs.hash_index_);
+    std::swap(lhs.scapegoat_alpha_, rhs.scapegoat_alpha_);
+    std::swap(lhs.node_resource_, rhs.node_resource_);
+    std::swap(lhs.snapshot_token_, rhs.snapshot_token_);
 }
@@ -0,0 +1,204 @@
+// coroutine support for treemap::co_find - a lookup that suspends at every node hop
+// lookup_task (the coroutine type), prefetch_hop (the awaitable) and interleave (the scheduler)
+
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace my
+{
+
+    // coroutine frames of one size, recycled per thread: a batch creates and destroys one frame
+    // per key, and malloc would cost more than the lookup saves
+    class coro_frame_pool
+    {
+    public:
+        static void *allocate(size_t size)
+        {
+            pool &p = instance_();
+            if (size == p.size_ && !p.free_.empty())
+            {
+                void *frame = p.free_.back();
+                p.free_.pop_back();
+                return frame;
+            }
+            return ::operator new(size);
+        }
+
+        static void deallocate(void *frame, size_t size)
+        {
+            pool &p = instance_();
+            if (p.size_ == 0)
+            {
+                p.size_ = size;
+            }
+            if (size == p.size_ && p.free_.size() < max_free)
+            {
+                p.free_.push_back(frame);
+                return;
+            }
+            ::operator delete(frame);
+        }
+
+    protected:
+        static const size_t max_free = 256;
+
+        struct pool
+        {
+            size_t size_ = 0; // the first size given back, the common case
+            std::vector<void *> free_;
+
+            ~pool()
+            {
+                for (void *frame : free_)
+                {
+                    ::operator delete(frame);
+                }
+            }
+        };
+
+        static pool &instance_()
+        {
+            thread_local pool p;
+            return p;
+        }
+    };
+
+    /*
+     * class lookup_task<R>
+     * coroutine that computes an R, run step by step by whoever holds it
+     * - created suspended; resume() runs it to its next suspension point, done() tells whether
+     *   it has returned, result() is the returned value
+     * - owns the coroutine frame (move-only), frames come from coro_frame_pool
+     * - an exception inside the coroutine is rethrown by result()
+     */
+    template <typename R>
+    class lookup_task
+    {
+    public:
+        struct promise_type
+        {
+            R result_{};
+            std::exception_ptr error_;
+
+            lookup_task get_return_object() { return lookup_task(handle::from_promise(*this)); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_value(R result) { result_ = std::move(result); }
+            void unhandled_exception() { error_ = std::current_exception(); }
+
+            static void *operator new(size_t size) { return coro_frame_pool::allocate(size); }
+            static void operator delete(void *frame, size_t size) { coro_frame_pool::deallocate(frame, size); }
+        };
+
+        lookup_task() = default;
+        lookup_task(lookup_task &&other) noexcept : coro_(std::exchange(other.coro_, nullptr)) {}
+        lookup_task &operator=(lookup_task &&other) noexcept
+        {
+            std::swap(coro_, other.coro_);
+            return *this;
+        }
+        ~lookup_task()
+        {
+            if (coro_)
+            {
+                coro_.destroy();
+            }
+        }
+
+        bool done() const { return !coro_ || coro_.done(); }
+        void resume() { coro_.resume(); }
+
+        // the returned value, after done()
+        R result() const
+        {
+            if (coro_.promise().error_)
+            {
+                std::rethrow_exception(coro_.promise().error_);
+            }
+            return coro_.promise().result_;
+        }
+
+        // run to completion, without interleaving
+        R get()
+        {
+            while (!done())
+            {
+                resume();
+            }
+            return result();
+        }
+
+    protected:
+        using handle = std::coroutine_handle<promise_type>;
+        handle coro_;
+
+        explicit lookup_task(handle coro) : coro_(coro) {}
+    };
+
+    // co_await prefetch_hop(p): start loading p's cache line and let the scheduler run other
+    // lookups meanwhile
+    struct prefetch_hop
+    {
+        const void *address_;
+
+        explicit prefetch_hop(const void *address) : address_(address) {}
+
+        bool await_ready() const noexcept
+        {
+            __builtin_prefetch(address_);
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        void await_resume() const noexcept {}
+    };
+
+    // run tasks 0..n-1 with up to width of them in flight on this thread, round-robin:
+    // make(i) creates task i, done(i, result) receives its result. while one task waits for a
+    // node to arrive from memory, the others compare keys of nodes that already have
+    template <typename Make, typename Done>
+    void interleave(size_t n, Make make, Done done, size_t width = 16)
+    {
+        using task = decltype(make(size_t(0)));
+        std::vector<task> slots(std::min(width == 0 ? 1 : width, n));
+        std::vector<size_t> items(slots.size());
+        size_t next = 0;
+        for (size_t s = 0; s < slots.size(); s++)
+        {
+            items[s] = next;
+            slots[s] = make(next++);
+        }
+        size_t running = slots.size();
+        while (running > 0)
+        {
+            for (size_t s = 0; s < slots.size(); s++)
+            {
+                if (slots[s].done())
+                {
+                    continue;
+                }
+                slots[s].resume();
+                if (slots[s].done())
+                {
+                    done(items[s], slots[s].result());
+                    if (next < n)
+                    {
+                        items[s] = next;
+                        slots[s] = make(next++);
+                    }
+                    else
+                    {
+                        slots[s] = task();
+                        running--;
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace my
@@ -0,0 +1,169 @@
+// treemap_diff - what changed between two versions of a map, and applying that to another copy
+// diff() walks both trees in key order and skips the subtrees the two versions still share
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "treemap_snapshot.h"
+
+namespace my
+{
+
+    // the changes that turn one version of a map into another
+    template <typename K, typename T>
+    struct treemap_delta
+    {
+        std::vector<std::pair<K, T>> upserts; // inserted or changed keys with their new value, ascending
+        std::vector<K> removed;               // ascending
+        size_t inserted = 0;                  // how many of upserts are new keys
+        size_t nodes_visited = 0;             // work done by diff(), for both trees together
+
+        bool empty() const { return upserts.empty() && removed.empty(); }
+        size_t size() const { return upserts.size() + removed.size(); }
+    };
+
+    /*
+     * diff(from, to)
+     * delta with every key that to has and from has not (inserted), that from has and to has
+     * not (removed), and that both have with different values (changed, needs T == T)
+     * - both trees are walked in key order at the same time; where both sides have the very same
+     *   subtree (a snapshot and the map it came from share every node the map has not written
+     *   since), the subtree is skipped without looking inside
+     * - the cost is the size of the change times the tree depth, not the size of the map: after
+     *   k writes, at most k paths differ
+     * - unrelated trees (e.g. a deep copy) share nothing and are compared element by element
+     */
+    template <typename K, typename T, typename Compare>
+    treemap_delta<K, T> diff(const treemap_snapshot<K, T, Compare> &from, const treemap_snapshot<K, T, Compare> &to)
+    {
+        using node = treemap_node<K, T>;
+
+        // a pending whole subtree (whole_ == true), or a single node whose left subtree is done
+        struct item
+        {
+            const node *node_;
+            bool whole_;
+        };
+
+        struct walk
+        {
+            std::vector<item> stack_;
+            size_t &visited_;
+
+            walk(const node *root, size_t &visited) : visited_(visited) { stack_.push_back({root, true}); }
+
+            // drop empty subtrees from the top
+            bool done()
+            {
+                while (!stack_.empty() && stack_.back().node_ == nullptr)
+                {
+                    stack_.pop_back();
+                }
+                return stack_.empty();
+            }
+
+            // top is a whole subtree: replace it by its right subtree, its node, its left subtree
+            void expand()
+            {
+                const node *n = stack_.back().node_;
+                stack_.pop_back();
+                visited_++;
+                stack_.push_back({n->right_.get(), true});
+                stack_.push_back({n, false});
+                stack_.push_back({n->left_.get(), true});
+            }
+
+            // the next single node (expanding whole subtrees down to it)
+            const node *next()
+            {
+                while (!done() && stack_.back().whole_)
+                {
+                    expand();
+                }
+                return done() ? nullptr : stack_.back().node_;
+            }
+        };
+
+        treemap_delta<K, T> delta;
+        walk a(from.root_.get(), delta.nodes_visited);
+        walk b(to.root_.get(), delta.nodes_visited);
+        const Compare &comp = to.comp_;
+        for (;;)
+        {
+            bool a_done = a.done(), b_done = b.done();
+            if (a_done || b_done)
+            {
+                for (const node *n; !a_done && (n = a.next()) != nullptr; a.stack_.pop_back())
+                {
+                    delta.removed.push_back(n->value_.first);
+                }
+                for (const node *n; !b_done && (n = b.next()) != nullptr; b.stack_.pop_back())
+                {
+                    delta.upserts.push_back(n->value_);
+                    delta.inserted++;
+                }
+                return delta;
+            }
+
+            item &top_a = a.stack_.back();
+            item &top_b = b.stack_.back();
+            if (top_a.whole_ && top_b.whole_)
+            {
+                // the same subtree on both sides: identical contents, nothing to look at
+                if (top_a.node_ == top_b.node_)
+                {
+                    a.stack_.pop_back();
+                    b.stack_.pop_back();
+                    continue;
+                }
+                // shared subtrees further down start where one of these starts, expanding
+                // both meets them
+                a.expand();
+                b.expand();
+                continue;
+            }
+
+            const node *x = a.next();
+            const node *y = b.next();
+            if (comp(x->value_.first, y->value_.first))
+            {
+                delta.removed.push_back(x->value_.first);
+                a.stack_.pop_back();
+            }
+            else if (comp(y->value_.first, x->value_.first))
+            {
+                delta.upserts.push_back(y->value_);
+                delta.inserted++;
+                b.stack_.pop_back();
+            }
+            else
+            {
+                if (x != y && !(x->value_.second == y->value_.second))
+                {
+                    delta.upserts.push_back(y->value_);
+                }
+                a.stack_.pop_back();
+                b.stack_.pop_back();
+            }
+        }
+    }
+
+    template <typename K, typename T, typename Compare>
+    class treemap;
+
+    // diff between the current contents of two maps (via snapshots, dropped again afterwards)
+    template <typename K, typename T, typename Compare>
+    treemap_delta<K, T> diff(const treemap<K, T, Compare> &from, const treemap<K, T, Compare> &to)
+    {
+        return diff(from.snapshot(), to.snapshot());
+    }
+
+    template <typename K, typename T, typename Compare>
+    treemap_delta<K, T> diff(const treemap_snapshot<K, T, Compare> &from, const treemap<K, T, Compare> &to)
+    {
+        return diff(from, to.snapshot());
+    }
+
+} // namespace my
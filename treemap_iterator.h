@@ -6,180 +6,165 @@
 // an iterator references a treemap_node, so it must know about it
 // please note that the iterator does *not* need to know the treemap itself! (except for the "friend" stateent below)
 #include "treemap_node.h"
-#include "treemap_node.h"
+#include <cassert>
+#include <cstddef>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <type_traits>
 using namespace std;
 
 namespace my
 {
 
     // forward declaration of treemap, just in case you want to keep a pointer to a treemap or such
-    template <typename K, typename T>
+    template <typename K, typename T, typename Compare>
     class treemap;
 
     // iterator: references a node within the tree
-    template <typename K, typename T>
+    // two plain pointers, copying and comparing touch no reference counts. like std::map, an
+    // iterator is invalidated when its element goes away (clear(), assignment, destruction of
+    // the map) and by writes while a snapshot exists (the map copies the nodes it writes to).
+    // Const = true is the const_iterator, an iterator converts to it
+    template <typename K, typename T, bool Const = false>
     class treemap_iterator
     {
     protected:
         // treemap is a friend, can call protected constructor
-        // template<typename KK, typename TT>
-        friend class treemap<K, T>;
-        friend class treemap_node<K, T>;
-
-
-        // weakpointer änderung für non owning stuff
-        using node_ptr = std::weak_ptr<treemap_node<K, T>>;
+        template <typename KK, typename TT, typename CC>
+        friend class treemap;
+        friend class treemap_iterator<K, T, !Const>;
 
+        using node = my::treemap_node<K, T>; // from treemap_node.h
+        using node_ptr = std::shared_ptr<node>;
 
-        // construct iterator referencing a speciic node
+        // construct iterator referencing a specific node (nullptr: end())
         // - only treemap shall be allowed to do so
-        treemap_iterator(node_ptr node)
-            : node_(node) {}
-
+        treemap_iterator(node *n, const node_ptr *root)
+            : node_(n), root_(root) {}
 
-        // Konstruktor der einen nullpointer akzeptiert und Root nimmt
-        treemap_iterator(std::nullptr_t, node_ptr root)
-            : node_(), root_(root) {}
-
-
-        // non-owning reference to the actual node
-        node_ptr node_;
-        // non_owning reference to the previous node
-        node_ptr previous_node_;
-        // non_owning reference to the root node
-        node_ptr root_;
+        // non-owning reference to the actual node, nullptr for end()
+        node *node_ = nullptr;
+        // the map's root link, --end() starts there
+        const node_ptr *root_ = nullptr;
 
     public:
         // type aliases, should be exactly the same as for treemap itself
         using key_type = K;
         using mapped_type = T;
         using value_type = std::pair<K, T>;
-        using node = my::treemap_node<K, T>; // from treemap_node.h
+        using iterator_category = std::bidirectional_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const, const value_type *, value_type *>;
+        using reference = std::conditional_t<Const, const value_type &, value_type &>;
+
+        treemap_iterator() = default;
+
+        // iterator -> const_iterator
+        template <bool C = Const, typename = std::enable_if_t<C>>
+        treemap_iterator(const treemap_iterator<K, T, false> &other)
+            : node_(other.node_), root_(other.root_) {}
 
         // access data of referenced map element (node)
-        value_type &operator*()
+        reference operator*() const
         {
-            {
-                auto locked_node = node_.lock();
-                assert(locked_node != nullptr); // node != null
-                return locked_node->value_;
-            }
+            assert(node_ != nullptr); // node != null
+            return node_->value_;
         }
-        value_type *operator->()
+        pointer operator->() const
         {
-            auto locked_node = node_.lock();
-            assert(locked_node != nullptr); // node != null
-            return &(locked_node->value_);
+            assert(node_ != nullptr); // node != null
+            return &node_->value_;
         }
 
         // two iterators are equal if they point to the same node
-        bool operator==(const treemap_iterator &rhs) const
-        {
-            auto rhs_locked_node = rhs.node_.lock();
-            auto locked_node = node_.lock();
-            return locked_node == rhs_locked_node;
-        }
-
-        bool operator!=(const treemap_iterator &rhs) const
-        {
-            auto rhs_locked_node = rhs.node_.lock();
-            auto locked_node = node_.lock();
-            return locked_node != rhs_locked_node;
-        }
+        template <bool C>
+        bool operator==(const treemap_iterator<K, T, C> &rhs) const { return node_ == rhs.node_; }
+        template <bool C>
+        bool operator!=(const treemap_iterator<K, T, C> &rhs) const { return node_ != rhs.node_; }
 
         // next element in map, pre-increment
         // note: must modify self!
         treemap_iterator &operator++()
         {
-            auto locked_node = node_.lock();
-            previous_node_ = node_;
-
             // end oder root bei leerem bauem anwednung verboooten!!!
-            assert(locked_node != nullptr);
+            assert(node_ != nullptr);
 
             // Wenn es einen rechten Teilbaum gibt, rechts und dann so weit wie möglich nach links
-            if (locked_node->right_)
+            if (node_->right_)
             {
-                locked_node = locked_node->right_;
+                node_ = node_->right_.get();
                 // falls links dann ganz nach unten
-                while (locked_node->left_)
+                while (node_->left_)
                 {
-                    locked_node = locked_node->left_;
+                    node_ = node_->left_.get();
                 }
             }
             else
             {
-
-                auto parent = locked_node->up_.lock();
                 // solange nach oben wie es ein elternknoten und wir von rechts kommen
-                while (parent && locked_node == parent->right_)
+                node *parent = node_->up_;
+                while (parent != nullptr && node_ == parent->right_.get())
                 {
-                    locked_node = parent;
-                    parent = parent->up_.lock();
+                    node_ = parent;
+                    parent = parent->up_;
                 }
-                locked_node = parent;
+                node_ = parent;
             }
-
-            node_ = locked_node;
             return *this;
         }
 
+        treemap_iterator operator++(int)
+        {
+            treemap_iterator old = *this;
+            ++*this;
+            return old;
+        }
+
         // prev element in map, pre-decrement
         // note: must modify self!
         treemap_iterator &operator--()
         {
-            auto locked_node = node_.lock();
-
-            if (!locked_node)
+            if (node_ == nullptr)
             {
-                auto previous_lock = previous_node_.lock();
-
-                // Wenn der Iterator bei end() ist, finde das größte Element
-                if (previous_lock)
-                {
-                    // falls der ++operator verwendet wurde kann mit previous zurück gegangen werden
-                    locked_node = previous_lock;
-                }
-
-                else
+                // falls mit end() -> viva la root und dann größtes element suchen
+                assert(root_ != nullptr && *root_);
+                node_ = root_->get();
+                while (node_->right_)
                 {
-                    // falls mit end() -> viva la root und dann größtes element suchen
-                    locked_node = root_.lock();
-                    while (locked_node && locked_node->right_)
-                    {
-                        locked_node = locked_node->right_;
-                    }
+                    node_ = node_->right_.get();
                 }
             }
-            else
+            else if (node_->left_)
             {
                 // Wenn es einen linken Teilbaum gibt, gehe nach links und dann so weit wie möglich nach rechts
-                if (locked_node->left_)
+                node_ = node_->left_.get();
+                while (node_->right_)
                 {
-                    locked_node = locked_node->left_;
-                    while (locked_node->right_)
-                    {
-                        locked_node = locked_node->right_;
-                    }
+                    node_ = node_->right_.get();
                 }
-                else
+            }
+            else
+            {
+                // Gehe nach oben, bis wir von rechts kommen
+                node *parent = node_->up_;
+                while (parent != nullptr && node_ == parent->left_.get())
                 {
-                    // Gehe nach oben, bis wir von rechts kommen
-                    auto parent = locked_node->up_.lock();
-                    while (parent && locked_node == parent->left_)
-                    {
-                        locked_node = parent;
-                        parent = parent->up_.lock();
-                    }
-                    locked_node = parent;
+                    node_ = parent;
+                    parent = parent->up_;
                 }
+                node_ = parent;
             }
-
-            node_ = locked_node;
             return *this;
         }
 
+        treemap_iterator operator--(int)
+        {
+            treemap_iterator old = *this;
+            --*this;
+            return old;
+        }
+
     }; // class iterator
 
 } // my::
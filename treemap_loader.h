@@ -0,0 +1,324 @@
+// treemap_loader - bulk load of a treemap from a key/value text or binary file
+// mmap'd input, parsing and sorting in parallel chunks, balanced build (or sorted merge) into the map
+// local files only (POSIX)
+
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "treemap.h"
+#include "treemap_parallel.h"
+
+namespace my
+{
+
+    // how a text field becomes a key or value
+    // arithmetic types with std::from_chars, std::string as is; specialize for others
+    template <typename V, typename = void>
+    struct text_codec;
+
+    template <typename V>
+    struct text_codec<V, std::enable_if_t<std::is_arithmetic_v<V>>>
+    {
+        static bool parse(std::string_view field, V &value)
+        {
+            auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+            return error == std::errc() && end == field.data() + field.size();
+        }
+    };
+
+    template <>
+    struct text_codec<std::string>
+    {
+        static bool parse(std::string_view field, std::string &value)
+        {
+            value.assign(field);
+            return true;
+        }
+    };
+
+    struct load_options
+    {
+        unsigned threads = 0;    // 0: one per hardware thread
+        char separator = ',';    // text files: between key and value
+        bool skip_header = false; // text files: ignore the first line
+    };
+
+    struct load_result
+    {
+        size_t rows = 0;  // records read (including keys that occurred again)
+        size_t bytes = 0; // file size
+        double seconds = 0;
+
+        double mb_per_s() const { return seconds > 0 ? double(bytes) / 1e6 / seconds : 0; }
+        double rows_per_s() const { return seconds > 0 ? double(rows) / seconds : 0; }
+    };
+
+    namespace loader_detail
+    {
+        // read-only mapping of a whole file
+        class mapped_file
+        {
+        public:
+            explicit mapped_file(const std::string &path)
+            {
+                int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0)
+                {
+                    throw std::system_error(errno, std::generic_category(), "open " + path);
+                }
+                struct stat st;
+                if (::fstat(fd, &st) != 0)
+                {
+                    int error = errno;
+                    ::close(fd);
+                    throw std::system_error(error, std::generic_category(), "fstat " + path);
+                }
+                size_ = size_t(st.st_size);
+                if (size_ > 0)
+                {
+                    void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (p == MAP_FAILED)
+                    {
+                        int error = errno;
+                        ::close(fd);
+                        throw std::system_error(error, std::generic_category(), "mmap " + path);
+                    }
+                    data_ = static_cast<const char *>(p);
+                    ::madvise(p, size_, MADV_SEQUENTIAL);
+                }
+                ::close(fd);
+            }
+
+            mapped_file(const mapped_file &) = delete;
+            mapped_file &operator=(const mapped_file &) = delete;
+
+            ~mapped_file()
+            {
+                if (data_ != nullptr)
+                {
+                    ::munmap(const_cast<char *>(data_), size_);
+                }
+            }
+
+            const char *data() const { return data_; }
+            size_t size() const { return size_; }
+
+        private:
+            const char *data_ = nullptr;
+            size_t size_ = 0;
+        };
+
+        // worker threads for a file of the given size: at most one per MB
+        inline unsigned thread_count(const load_options &options, size_t bytes)
+        {
+            unsigned threads = options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+            return unsigned(std::max<size_t>(1, std::min<size_t>(threads, bytes >> 20)));
+        }
+
+        // run work(i) for i < n on n threads
+        using parallel_detail::parallel;
+
+        // the chunks are sorted and in file order: merge them pairwise in parallel rounds,
+        // keep the last occurrence of every key and put the result into the map
+        template <typename K, typename T, typename Compare>
+        void merge_into(std::vector<std::vector<std::pair<K, T>>> &chunks, treemap<K, T, Compare> &map)
+        {
+            auto less = [comp = map.key_comp()](const std::pair<K, T> &a, const std::pair<K, T> &b)
+            { return comp(a.first, b.first); };
+            while (chunks.size() > 1)
+            {
+                std::vector<std::vector<std::pair<K, T>>> merged(chunks.size() / 2);
+                parallel(unsigned(merged.size()), [&](unsigned i)
+                         {
+                    auto &a = chunks[2 * i];
+                    auto &b = chunks[2 * i + 1];
+                    merged[i].reserve(a.size() + b.size());
+                    // std::merge is stable: equal keys of the earlier chunk come first
+                    std::merge(std::make_move_iterator(a.begin()), std::make_move_iterator(a.end()),
+                               std::make_move_iterator(b.begin()), std::make_move_iterator(b.end()),
+                               std::back_inserter(merged[i]), less);
+                    std::vector<std::pair<K, T>>().swap(a);
+                    std::vector<std::pair<K, T>>().swap(b); });
+                if (chunks.size() % 2 != 0)
+                {
+                    merged.push_back(std::move(chunks.back()));
+                }
+                chunks = std::move(merged);
+            }
+            if (chunks.empty())
+            {
+                return;
+            }
+
+            auto &all = chunks.front();
+            auto out = all.begin();
+            for (auto it = all.begin(); it != all.end(); ++it)
+            {
+                if (std::next(it) == all.end() || less(*it, *std::next(it)))
+                {
+                    if (out != it)
+                    {
+                        *out = std::move(*it);
+                    }
+                    ++out;
+                }
+            }
+            all.erase(out, all.end());
+            map.insert_or_assign_sorted(all.begin(), all.end());
+        }
+
+        inline double since(std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+    } // namespace loader_detail
+
+    /*
+     * load_text(path, map, options)
+     * one record per line: key, separator, value (split at the first separator, no quoting);
+     * empty lines are skipped, a trailing '\r' is ignored
+     * - the file is mmap'd and cut into one chunk per thread at line boundaries; every thread
+     *   parses its chunk with text_codec and sorts it, the sorted chunks are merged pairwise
+     * - an empty map is then built perfectly balanced from the sorted records, a filled one gets
+     *   them with insert_or_assign_sorted; a key that occurs more than once keeps its last value,
+     *   as with map[key] = value line by line
+     * - a malformed line throws std::runtime_error naming its byte offset, I/O errors
+     *   std::system_error; the map is unchanged then
+     */
+    template <typename K, typename T, typename Compare>
+    load_result load_text(const std::string &path, treemap<K, T, Compare> &map, const load_options &options = {})
+    {
+        auto start = std::chrono::steady_clock::now();
+        loader_detail::mapped_file file(path);
+        const char *data = file.data();
+        const char *end = data + file.size();
+        if (options.skip_header && data != end)
+        {
+            const char *eol = static_cast<const char *>(std::memchr(data, '\n', size_t(end - data)));
+            data = eol != nullptr ? eol + 1 : end;
+        }
+
+        // chunk boundaries: the start of the line that contains the even split point
+        // (a chunk holds at least 1 MB, so every split point lies behind data)
+        unsigned threads = loader_detail::thread_count(options, size_t(end - data));
+        std::vector<const char *> bounds(threads + 1, end);
+        bounds[0] = data;
+        for (unsigned i = 1; i < threads; i++)
+        {
+            const char *p = std::max(bounds[i - 1], data + size_t(end - data) / threads * i);
+            const char *eol = p == end ? nullptr : static_cast<const char *>(std::memchr(p - 1, '\n', size_t(end - p + 1)));
+            bounds[i] = eol == nullptr ? end : eol + 1;
+        }
+
+        std::vector<std::vector<std::pair<K, T>>> chunks(threads);
+        loader_detail::parallel(threads, [&](unsigned i)
+                                {
+            auto &records = chunks[i];
+            auto less = [comp = map.key_comp()](const std::pair<K, T> &a, const std::pair<K, T> &b)
+            { return comp(a.first, b.first); };
+            for (const char *line = bounds[i]; line < bounds[i + 1];)
+            {
+                const char *eol = static_cast<const char *>(std::memchr(line, '\n', size_t(bounds[i + 1] - line)));
+                if (eol == nullptr)
+                {
+                    eol = bounds[i + 1];
+                }
+                std::string_view text(line, size_t(eol - line));
+                if (!text.empty() && text.back() == '\r')
+                {
+                    text.remove_suffix(1);
+                }
+                if (!text.empty())
+                {
+                    size_t sep = text.find(options.separator);
+                    std::pair<K, T> record;
+                    if (sep == std::string_view::npos ||
+                        !text_codec<K>::parse(text.substr(0, sep), record.first) ||
+                        !text_codec<T>::parse(text.substr(sep + 1), record.second))
+                    {
+                        throw std::runtime_error(path + ": malformed record at byte " + std::to_string(line - file.data()));
+                    }
+                    records.push_back(std::move(record));
+                }
+                line = eol + 1;
+            }
+            std::stable_sort(records.begin(), records.end(), less); });
+
+        load_result result;
+        result.bytes = file.size();
+        for (auto &c : chunks)
+        {
+            result.rows += c.size();
+        }
+        loader_detail::merge_into(chunks, map);
+        result.seconds = loader_detail::since(start);
+        return result;
+    }
+
+    /*
+     * load_binary(path, map, options)
+     * packed records of sizeof(K) key bytes followed by sizeof(T) value bytes, native byte order,
+     * for trivially copyable K and T; same pipeline and duplicate rule as load_text
+     * - a file size that is not a multiple of the record size throws std::runtime_error
+     */
+    template <typename K, typename T, typename Compare>
+    load_result load_binary(const std::string &path, treemap<K, T, Compare> &map, const load_options &options = {})
+    {
+        static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<T>,
+                      "load_binary needs trivially copyable keys and values");
+        constexpr size_t record_size = sizeof(K) + sizeof(T);
+
+        auto start = std::chrono::steady_clock::now();
+        loader_detail::mapped_file file(path);
+        if (file.size() % record_size != 0)
+        {
+            throw std::runtime_error(path + ": size is not a multiple of " + std::to_string(record_size) + " bytes");
+        }
+        size_t rows = file.size() / record_size;
+
+        unsigned threads = loader_detail::thread_count(options, file.size());
+        std::vector<std::vector<std::pair<K, T>>> chunks(threads);
+        loader_detail::parallel(threads, [&](unsigned i)
+                                {
+            size_t first = rows / threads * i;
+            size_t last = i + 1 == threads ? rows : rows / threads * (i + 1);
+            auto &records = chunks[i];
+            records.resize(last - first);
+            const char *p = file.data() + first * record_size;
+            for (auto &record : records)
+            {
+                std::memcpy(&record.first, p, sizeof(K));
+                std::memcpy(&record.second, p + sizeof(K), sizeof(T));
+                p += record_size;
+            }
+            std::stable_sort(records.begin(), records.end(), [comp = map.key_comp()](const std::pair<K, T> &a, const std::pair<K, T> &b)
+                             { return comp(a.first, b.first); }); });
+
+        load_result result;
+        result.rows = rows;
+        result.bytes = file.size();
+        loader_detail::merge_into(chunks, map);
+        result.seconds = loader_detail::since(start);
+        return result;
+    }
+
+} // namespace my
@@ -3,11 +3,22 @@
 
 #pragma once
 
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
+#include <tuple>
+#include <utility>
 
 namespace my
 {
 
+    // stands for T() where a mapped value is passed: the node value-initializes it in place
+    // (operator[] on a missing key), instead of copying a temporary
+    struct default_value_t
+    {
+    };
+    inline constexpr default_value_t default_value{};
+
     // this is the template for a node in the treemap's tree
     // please note that the node does not need to know anything about the treemap itself (or about the iterator, later)
     template <typename K, typename T>
@@ -22,11 +33,20 @@ namespace my
 
         // public attributes
         std::pair<K, T> value_;
-        std::weak_ptr<node> up_;
+        // non-owning, the parent owns this node; nullptr for the root
+        node *up_ = nullptr;
         node_ptr left_, right_;
 
-        treemap_node(K key, T mapped, node_ptr up)
-            : value_(std::make_pair(key, mapped)), up_(up), left_(), right_()
+        // key and mapped are forwarded into value_: one copy from lvalues, one move from rvalues
+        template <typename KK, typename TT>
+        treemap_node(KK &&key, TT &&mapped, node *up)
+            : value_(std::forward<KK>(key), std::forward<TT>(mapped)), up_(up), left_(), right_()
+        {
+        }
+
+        template <typename KK>
+        treemap_node(KK &&key, default_value_t, node *up)
+            : value_(std::piecewise_construct, std::forward_as_tuple(std::forward<KK>(key)), std::forward_as_tuple()), up_(up), left_(), right_()
         {
         }
 
@@ -36,46 +56,62 @@ namespace my
         {
         }
 
+        // new node in resource's memory (node and control block in one allocation, like
+        // make_shared, which is used when resource is nullptr)
+        template <typename KK, typename TT>
+        static node_ptr make(KK &&key, TT &&mapped, node *up, std::pmr::memory_resource *resource)
+        {
+            if (resource == nullptr)
+            {
+                return std::make_shared<node>(std::forward<KK>(key), std::forward<TT>(mapped), up);
+            }
+            return std::allocate_shared<node>(std::pmr::polymorphic_allocator<node>(resource), std::forward<KK>(key), std::forward<TT>(mapped), up);
+        }
+
         // try to insert new (key,mapped) node in tree, return (new node, true)
         // if key already in tree, do not overwrite, just return (existing node, false)
-        std::pair<node_ptr, bool> insert(K key, T mapped)
+        // walks down with a single comp() per node and remembers the deepest node whose key is
+        // not greater than key - that is the only node which can be equal to key
+        // if visited is given, the number of nodes walked through is added to it
+        // mapped is a T or default_value
+        template <typename Compare, typename M>
+        std::pair<node_ptr, bool> insert(const K &key, const M &mapped, const Compare &comp, size_t *visited = nullptr,
+                                         std::pmr::memory_resource *resource = nullptr)
         {
-            // Wenn der Schlüssel kleiner als der aktuelle Schlüssel ist
-            if (key < value_.first)
+            node *current = this;
+            node *not_greater = nullptr;
+            bool go_left = false;
+
+            for (;;)
             {
-                // Wenn kein linker Knoten existiert, wird ein neuer knoten erstellt
-                if (!left_)
-                {
-                    left_ = std::make_shared<node>(key, mapped, this->shared_from_this());
-                    return std::make_pair(left_, true);
-                }
-                // Ansonsten wird rekursion fortgesetzt
-                else
+                if (visited != nullptr)
                 {
-                    return left_->insert(key, mapped);
+                    ++*visited;
                 }
-            }
-            // Wenn der Schlüssel größer als der aktuelle Schlüssel ist
-            else if (key > value_.first)
-            {
-                // Wenn kein rechter Knoten existiert, wird eine neuer knoten erstellt
-                if (!right_)
+                go_left = comp(key, current->value_.first);
+                if (!go_left)
                 {
-                    right_ = std::make_shared<node>(key, mapped, this->shared_from_this());
-                    return std::make_pair(right_, true);
+                    not_greater = current;
                 }
-                // Ansonsten fahren Sie mit der Rekursion fort
-                else
+
+                node_ptr &next = go_left ? current->left_ : current->right_;
+                if (!next)
                 {
-                    // Ansonsten wird rekursion fortgesetzt
-                    return right_->insert(key, mapped);
+                    break;
                 }
+                current = next.get();
             }
-            // Wenn der Schlüssel bereits existiert, wird der aktuelle knoten zurück gegeben
-            else
+
+            // Wenn der Schlüssel bereits existiert, wird der vorhandene knoten zurück gegeben
+            if (not_greater != nullptr && !comp(not_greater->value_.first, key))
             {
-                return std::make_pair(this->shared_from_this(), false);
+                return std::make_pair(not_greater->shared_from_this(), false);
             }
+
+            // ansonsten wird ein neuer knoten als linkes oder rechtes kind erstellt
+            node_ptr &slot = go_left ? current->left_ : current->right_;
+            slot = make(key, mapped, current, resource);
+            return std::make_pair(slot, true);
         }
         // rekursive methode zum finden des knoten mit dem kleinsten wert
         node_ptr find_min()
@@ -0,0 +1,139 @@
+// treemap_parallel - thread helpers for bulk construction (treemap::from_unsorted, treemap_loader)
+// plain std::thread fork/join, no thread pool
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory_resource>
+#include <thread>
+#include <vector>
+
+namespace my
+{
+
+    // which value a key that occurs more than once in a bulk input keeps
+    enum class duplicate_keys
+    {
+        last_wins,  // like map[key] = value for every element in input order
+        first_wins, // like map.insert(key, value) for every element in input order
+    };
+
+    struct build_policy
+    {
+        unsigned threads = 0; // 0: one per hardware thread
+        duplicate_keys duplicates = duplicate_keys::last_wins;
+        std::pmr::memory_resource *resource = nullptr; // node memory of the new map (treemap::node_resource)
+    };
+
+    namespace parallel_detail
+    {
+        // requested threads, 0 meaning all hardware threads, but at least min_per_thread items each
+        inline unsigned thread_count(unsigned requested, size_t items, size_t min_per_thread)
+        {
+            unsigned threads = requested != 0 ? requested : std::max(1u, std::thread::hardware_concurrency());
+            return unsigned(std::max<size_t>(1, std::min<size_t>(threads, items / min_per_thread)));
+        }
+
+        // run work(i) for i < n on n threads, rethrow the first error after all have finished
+        template <typename Work>
+        void parallel(unsigned n, Work work)
+        {
+            std::vector<std::exception_ptr> errors(n);
+            std::vector<std::thread> threads;
+            for (unsigned i = 1; i < n; i++)
+            {
+                threads.emplace_back([&, i]
+                                     {
+                    try
+                    {
+                        work(i);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    } });
+            }
+            try
+            {
+                work(0);
+            }
+            catch (...)
+            {
+                errors[0] = std::current_exception();
+            }
+            for (auto &t : threads)
+            {
+                t.join();
+            }
+            for (auto &error : errors)
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+        }
+
+        // stable sort on up to threads threads: sorted chunks, then rounds of pairwise merges;
+        // every merge is cut into pieces at split keys, so the last rounds use all threads too
+        template <typename V, typename Less>
+        void stable_sort(std::vector<V> &v, Less less, unsigned threads)
+        {
+            threads = thread_count(threads, v.size(), size_t(1) << 14);
+            if (threads <= 1)
+            {
+                std::stable_sort(v.begin(), v.end(), less);
+                return;
+            }
+            std::vector<size_t> bounds(threads + 1);
+            for (unsigned i = 0; i <= threads; i++)
+            {
+                bounds[i] = v.size() / threads * i;
+            }
+            bounds[threads] = v.size();
+            parallel(threads, [&](unsigned i)
+                     { std::stable_sort(v.begin() + bounds[i], v.begin() + bounds[i + 1], less); });
+
+            std::vector<V> buffer(v.size());
+            while (bounds.size() > 2)
+            {
+                size_t merges = (bounds.size() - 1) / 2;
+                unsigned pieces = unsigned(std::max<size_t>(1, threads / merges));
+                parallel(unsigned(merges * pieces), [&](unsigned job)
+                         {
+                    size_t m = job / pieces, p = job % pieces;
+                    auto a = v.begin() + bounds[2 * m], a_end = v.begin() + bounds[2 * m + 1];
+                    auto b_end = v.begin() + bounds[2 * m + 2];
+                    // piece p: its share of the first run, and the elements of the second run
+                    // that go before the first run's next piece (equal ones after, for stability)
+                    size_t a_size = size_t(a_end - a);
+                    auto a_from = a + a_size * p / pieces, a_to = a + a_size * (p + 1) / pieces;
+                    auto b_from = p == 0 ? a_end : a_from == a_end ? b_end : std::lower_bound(a_end, b_end, *a_from, less);
+                    auto b_to = p + 1 == pieces || a_to == a_end ? b_end : std::lower_bound(a_end, b_end, *a_to, less);
+                    std::merge(std::make_move_iterator(a_from), std::make_move_iterator(a_to),
+                               std::make_move_iterator(b_from), std::make_move_iterator(b_to),
+                               buffer.begin() + (a_from - v.begin()) + (b_from - a_end), less); });
+                // an odd run out has nothing to merge with
+                if ((bounds.size() - 1) % 2 != 0)
+                {
+                    std::move(v.begin() + bounds[bounds.size() - 2], v.end(), buffer.begin() + bounds[bounds.size() - 2]);
+                }
+                v.swap(buffer);
+                std::vector<size_t> merged;
+                for (size_t i = 0; i < bounds.size(); i += 2)
+                {
+                    merged.push_back(bounds[i]);
+                }
+                if (merged.back() != v.size())
+                {
+                    merged.push_back(v.size());
+                }
+                bounds = std::move(merged);
+            }
+        }
+    } // namespace parallel_detail
+
+} // namespace my
@@ -0,0 +1,156 @@
+// treemap_snapshot - read-only point-in-time view of a treemap, see treemap::snapshot()
+// shares all nodes with the map it was taken from, the map copies what it changes later
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "treemap_node.h"
+
+namespace my
+{
+    template <typename K, typename T, typename Compare>
+    class treemap;
+
+    template <typename K, typename T, typename Compare>
+    class treemap_snapshot;
+
+    template <typename K, typename T>
+    struct treemap_delta;
+
+    // iterator of a snapshot: the stack of nodes whose left subtree is being visited
+    // it never follows up_ links - those belong to the live map once it has copied a node
+    template <typename K, typename T, typename Compare>
+    class treemap_snapshot_iterator
+    {
+    protected:
+        friend class treemap_snapshot<K, T, Compare>;
+
+        using node = treemap_node<K, T>;
+
+        treemap_snapshot_iterator() = default;
+
+        // push n and its chain of left children
+        void push_left_(const node *n)
+        {
+            for (; n != nullptr; n = n->left_.get())
+            {
+                stack_.push_back(n);
+            }
+        }
+
+        // top is the current node, empty for end()
+        std::vector<const node *> stack_;
+
+    public:
+        // type aliases, should be exactly the same as for treemap itself
+        using key_type = K;
+        using mapped_type = T;
+        using value_type = std::pair<K, T>;
+
+        const value_type &operator*() const { return stack_.back()->value_; }
+        const value_type *operator->() const { return &stack_.back()->value_; }
+
+        bool operator==(const treemap_snapshot_iterator &rhs) const
+        {
+            return stack_.empty() ? rhs.stack_.empty() : !rhs.stack_.empty() && stack_.back() == rhs.stack_.back();
+        }
+        bool operator!=(const treemap_snapshot_iterator &rhs) const { return !(*this == rhs); }
+
+        // next element, pre-increment
+        treemap_snapshot_iterator &operator++()
+        {
+            const node *current = stack_.back();
+            stack_.pop_back();
+            push_left_(current->right_.get());
+            return *this;
+        }
+
+    }; // class treemap_snapshot_iterator
+
+    /*
+     * class treemap_snapshot<K,T,Compare>
+     * immutable view of a treemap at the time snapshot() was called
+     * - O(1) to take: it only holds the map's root node
+     * - the map copies every shared node on the path it writes to (copy-on-write), so the view
+     *   never changes; after n writes at most n paths exist twice
+     * - may be read by another thread while the map is written; the map itself must not be
+     *   used concurrently
+     * - forward iteration only (the stack iterator above)
+     */
+    template <typename K, typename T, typename Compare>
+    class treemap_snapshot
+    {
+    public:
+        // public type aliases
+        using key_type = K;
+        using mapped_type = T;
+        using value_type = std::pair<K, T>;
+        using key_compare = Compare;
+        using iterator = treemap_snapshot_iterator<K, T, Compare>;
+        using const_iterator = iterator;
+
+        // number of keys in the view
+        size_t size() const { return count_; }
+
+        // how often is the element contained? (0 or 1)
+        size_t count(const K &key) const { return find(key) == end() ? 0 : 1; }
+
+        iterator begin() const
+        {
+            iterator it;
+            it.push_left_(root_.get());
+            return it;
+        }
+
+        iterator end() const { return iterator(); }
+
+        // first element whose key is not less than the given key, end() if there is none
+        // the nodes where the descent turned left are exactly the iterator's stack
+        iterator lower_bound(const K &key) const
+        {
+            iterator it;
+            for (const node *current = root_.get(); current != nullptr;)
+            {
+                if (!comp_(current->value_.first, key))
+                {
+                    it.stack_.push_back(current);
+                    current = current->left_.get();
+                }
+                else
+                {
+                    current = current->right_.get();
+                }
+            }
+            return it;
+        }
+
+        iterator find(const K &key) const
+        {
+            iterator it = lower_bound(key);
+            return it != end() && !comp_(key, it->first) ? it : end();
+        }
+
+    protected:
+        friend class treemap<K, T, Compare>;
+        template <typename KK, typename TT, typename CC>
+        friend treemap_delta<KK, TT> diff(const treemap_snapshot<KK, TT, CC> &, const treemap_snapshot<KK, TT, CC> &);
+
+        using node = treemap_node<K, T>;
+        using node_ptr = std::shared_ptr<node>;
+
+        treemap_snapshot(node_ptr root, size_t count, const Compare &comp, std::shared_ptr<char> token)
+            : root_(std::move(root)), count_(count), comp_(comp), token_(std::move(token))
+        {
+        }
+
+        node_ptr root_;
+        size_t count_;
+        [[no_unique_address]] Compare comp_;
+        // held while the snapshot lives, tells the map that its nodes may be shared
+        std::shared_ptr<char> token_;
+    };
+
+} // namespace my
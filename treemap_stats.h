@@ -0,0 +1,75 @@
+// introspection of a treemap
+// - hot-path counters, compiled in with -DTREEMAP_STATS
+//   without the define the counting statements vanish and treemap keeps its size
+// - tree shape and memory footprint, always available (treemap::shape_stats())
+
+#pragma once
+
+#include <cstddef>
+
+// add n to counter of the treemap_stats stats points to (may be nullptr)
+#ifdef TREEMAP_STATS
+#define TREEMAP_COUNT(stats, counter, n)  \
+    do                                    \
+    {                                     \
+        if ((stats) != nullptr)           \
+        {                                 \
+            (stats)->counter += (n);      \
+        }                                 \
+    } while (0)
+#else
+#define TREEMAP_COUNT(stats, counter, n) \
+    do                                   \
+    {                                    \
+    } while (0)
+#endif
+
+namespace my
+{
+
+    // true if the counters are compiled in
+#ifdef TREEMAP_STATS
+    inline constexpr bool treemap_stats_enabled = true;
+#else
+    inline constexpr bool treemap_stats_enabled = false;
+#endif
+
+    // snapshot of a treemap's counters, see treemap::stats()
+    struct treemap_stats
+    {
+        size_t comparisons = 0;          // calls of the Compare object
+        size_t lookups = 0;              // descents of find/count/operator[]/lower_bound (not answered by cache or filter)
+        size_t lookup_nodes_visited = 0; // nodes visited by those descents
+        size_t inserts = 0;              // insert/insert_or_assign/operator[] descents
+        size_t insert_nodes_visited = 0; // nodes visited by those descents
+        size_t node_allocations = 0;     // nodes created (insert and copy)
+
+        double average_lookup_depth() const
+        {
+            return lookups == 0 ? 0.0 : double(lookup_nodes_visited) / double(lookups);
+        }
+
+        double average_insert_depth() const
+        {
+            return inserts == 0 ? 0.0 : double(insert_nodes_visited) / double(inserts);
+        }
+    };
+
+    // shape and memory footprint of a treemap, see treemap::shape_stats()
+    struct treemap_shape
+    {
+        size_t nodes = 0;             // nodes actually found in the tree
+        size_t count = 0;             // what size() reports, equal to nodes unless the map is broken
+        size_t height = 0;            // levels of the tree, 0 if empty, 1 for a single node
+        size_t leaves = 0;            // nodes without children
+        size_t min_leaf_depth = 0;    // levels down to the shallowest leaf
+        size_t max_leaf_depth = 0;    // levels down to the deepest leaf (== height)
+        double average_leaf_depth = 0;
+        size_t bytes_per_node = 0;    // one allocation: node, shared_ptr control block, malloc overhead
+        size_t bytes = 0;             // nodes plus the map object, front cache and bloom filter
+        bool rebalance_recommended = false; // higher than any red-black tree with as many nodes
+
+        bool consistent() const { return nodes == count; }
+    };
+
+} // namespace my